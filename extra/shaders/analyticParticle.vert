@@ -0,0 +1,124 @@
+// analyticParticle.vert
+// Particles are not simulated on the CPU. Every vertex of a quad carries the spawn
+// frame, a random seed and the spawn position, and the particle is evaluated from its
+// age with the same per-frame steps as ParticleEmitter::update, in closed form.
+
+uniform float u_time;           // particle updates since reset
+uniform float u_lifeSpan;
+uniform float u_randomLifeSpan;
+uniform float u_speed;
+uniform float u_randomSpeed;
+uniform float u_angle;
+uniform float u_randomDirection;
+uniform float u_allDirections;
+uniform vec2 u_randomVelocity;
+uniform vec2 u_size;
+uniform vec2 u_randomSize;
+uniform vec2 u_damping;
+uniform float u_randomDamping;
+uniform vec4 u_color;           // 0 to 255
+uniform float u_randomAlpha;
+uniform float u_fadeIn;
+uniform float u_maxAccel;
+uniform sampler2D u_colorLUT;   // 256 x 1
+uniform float u_useColorLUT;
+uniform float u_lutAgeScale;
+uniform vec4 u_tiles[32];       // topLeft.xy, bottomRight.xy
+uniform float u_tileCount;
+
+float hash(float p)
+{
+    p = fract(p * 0.1031);
+    p *= p + 33.33;
+    p *= p + p;
+    return fract(p);
+}
+
+// k-th random number of this particle, 0 to 1
+float random(float k)
+{
+    return hash(gl_MultiTexCoord0.y * 1.37 + k * 101.3);
+}
+
+float randomRange(float k, float range)
+{
+    return (random(k) * 2.0 - 1.0) * range;
+}
+
+// Distance after n steps of: v += a, p += v, v *= d
+float travel(float n, float d, float v0, float a)
+{
+    if (1.0 - d < 0.0001)
+        return v0 * n + a * n * (n + 1.0) * 0.5;
+    float g = (1.0 - pow(d, n)) / (1.0 - d);
+    return v0 * g + (a / (1.0 - d)) * (n - d * g);
+}
+
+void main()
+{
+    // gl_Color.r: corner 0 to 5 (TL, TR, BL, TR, BR, BL), gl_Color.gb: force at spawn
+    float corner = floor(gl_Color.r * 255.0 + 0.5);
+    vec2 offset = vec2(0.0, 0.0);
+    if (corner == 1.0 || corner == 3.0 || corner == 4.0) offset.x = 1.0;
+    if (corner == 2.0 || corner == 4.0 || corner == 5.0) offset.y = 1.0;
+    vec2 accel = ((gl_Color.gb * 255.0 - 128.0) / 127.0) * u_maxAccel;
+    float n = u_time - gl_MultiTexCoord0.x;
+
+    float angle = (u_allDirections > 0.5 ? random(0.0) * 360.0 : u_angle);
+    angle += randomRange(1.0, angle * u_randomDirection);
+    float speed = u_speed + randomRange(2.0, u_speed * u_randomSpeed);
+    float rad = radians(angle);
+    vec2 velocity = vec2(speed * cos(rad), -speed * sin(rad));
+    velocity += vec2(randomRange(3.0, velocity.x * u_randomVelocity.x), randomRange(4.0, velocity.y * u_randomVelocity.y));
+    float life = u_lifeSpan + randomRange(5.0, u_lifeSpan * u_randomLifeSpan);
+    // The alpha variation is an integer and wraps around like the 8 bit channel did
+    float alphaVar = floor(u_color.a * u_randomAlpha);
+    float alpha = mod(u_color.a + floor(random(6.0) * (2.0 * alphaVar + 1.0)) - alphaVar, 256.0);
+    vec2 size = u_size + vec2(randomRange(7.0, u_size.x * u_randomSize.x), randomRange(8.0, u_size.y * u_randomSize.y));
+    vec2 damping = vec2(0.0, 0.0);
+    if (u_randomDamping > 0.5)
+        damping = vec2(random(9.0) * u_damping.x, random(10.0) * u_damping.y);
+    vec2 d = 1.0 - min(damping, vec2(0.9999));
+
+    // Fade in, then the alpha drops by two steps per update until alpha or life run out
+    float alphaStep = alpha / life;
+    float fadeFrames = 0.0;
+    float fullLife = life;
+    float outAlpha = 0.0;
+    if (u_fadeIn > 0.5)
+    {
+        float fadeStep = alphaStep * (u_lifeSpan / 100.0);
+        fadeFrames = ceil(alpha / fadeStep);
+        fullLife = life * 0.5;
+        outAlpha = floor(n * fadeStep);
+    }
+    float m = n - fadeFrames;
+    float remainingAlpha = alpha - 2.0 * alphaStep * max(m, 0.0);
+    float remainingLife = fullLife - max(m, 0.0);
+    if (m >= 0.0)
+        outAlpha = floor(remainingAlpha + 0.5);
+    bool dead = n < 1.0 || (m > 0.0 && (remainingAlpha <= 0.0 || remainingLife <= 0.0));
+
+    float tile = u_tileCount - floor(u_tileCount * (remainingLife / fullLife) + 0.5);
+    vec4 uvRect = u_tiles[int(clamp(tile, 0.0, u_tileCount - 1.0))];
+
+    vec3 color = u_color.rgb / 255.0;
+    if (u_useColorLUT > 0.5)
+    {
+        float index = min(floor((n - 1.0) * u_lutAgeScale), 255.0);
+        color = texture2DLod(u_colorLUT, vec2((index + 0.5) / 256.0, 0.5), 0.0).rgb;
+    }
+
+    vec2 position = gl_Vertex.xy + vec2(travel(n, d.x, velocity.x, accel.x), travel(n, d.y, velocity.y, accel.y));
+    position += offset * size;
+
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);
+    gl_TexCoord[0] = vec4(mix(uvRect.x, uvRect.z, offset.x), mix(uvRect.y, uvRect.w, offset.y), 0.0, 1.0);
+    gl_FrontColor = vec4(color, clamp(outAlpha, 0.0, 255.0) / 255.0);
+    if (dead)
+    {
+        // Collapses the quad, nothing is rasterised
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_FrontColor = vec4(0.0);
+    }
+}
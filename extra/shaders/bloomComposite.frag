@@ -0,0 +1,14 @@
+// bloomComposite.frag
+// Adds the blurred glow to the frame. Notes are hollow, so the bloom is masked by
+// the note shapes in hollowMask here instead of in a pass of its own.
+
+uniform sampler2D texture;
+uniform sampler2D hollowMask;
+
+void main()
+{
+    vec2 uv = gl_TexCoord[0].xy;
+    vec4 bloom = texture2D(texture, uv);
+    float mask = texture2D(hollowMask, uv).a;
+    gl_FragColor = vec4(bloom.rgb * (1.0 - mask), bloom.a) * gl_Color;
+}
@@ -4,9 +4,20 @@
 uniform vec2 resolution; /* Resolution Reciprocal */
 uniform float offset; /* Offset multiplier for blur strength */
 uniform float bloomStrength; /* bloom strength */
+uniform bool applyThreshold; /* First downsample only: reads the raw glow buffer */
+uniform float threshold;
 
 uniform sampler2D texture;
 
+vec4 sampleGlow(vec2 uv) {
+    vec4 color = texture2D(texture, uv);
+    if (!applyThreshold)
+        return color;
+    float brightness = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+    float amount = clamp((brightness - threshold) / (1.0 - threshold), 0.0, 1.0);
+    return vec4(color.rgb * amount, color.a); /* Keep alpha */
+}
+
 void main() {
     /* Dual Kawase downsample: sample center + 4 diagonal corners */
     vec2 uv = gl_TexCoord[0].xy;
@@ -14,13 +25,13 @@ void main() {
     vec2 o = halfpixel * offset;
 
     /* Sample center with 4x weight */
-    vec4 color = texture2D(texture, uv) * 4.0;
+    vec4 color = sampleGlow(uv) * 4.0;
 
     /* Sample 4 diagonal corners with 1x weight each */
-    color += texture2D(texture, uv + vec2(-o.x, -o.y)); /* bottom-left */
-    color += texture2D(texture, uv + vec2(o.x, -o.y)); /* bottom-right   */
-    color += texture2D(texture, uv + vec2(-o.x, o.y)); /* top-left */
-    color += texture2D(texture, uv + vec2(o.x, o.y)); /* top-right */
+    color += sampleGlow(uv + vec2(-o.x, -o.y)); /* bottom-left */
+    color += sampleGlow(uv + vec2(o.x, -o.y)); /* bottom-right   */
+    color += sampleGlow(uv + vec2(-o.x, o.y)); /* top-left */
+    color += sampleGlow(uv + vec2(o.x, o.y)); /* top-right */
 
     /* Apply bloom strength and normalize by total weight (8) */
     gl_FragColor = (color / 8.0) * bloomStrength;
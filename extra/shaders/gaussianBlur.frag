@@ -1,45 +1,44 @@
+// gaussianBlur.frag
+// One direction of a separable Gaussian. Weights and offsets come precomputed from
+// VPianoResources::buildGaussianKernel, already folded into bilinear tap pairs, so
+// each tap reads two texels at once. The first pass of a frame reads the raw glow
+// buffer and applies the bloom threshold to every tap.
+
 uniform sampler2D texture;
 uniform vec2 direction;
 uniform float resolution;
-uniform float radius;
 uniform float bloomIntensity;
+uniform float offsets[32];
+uniform float weights[32];
+uniform int tapCount;
+uniform bool applyThreshold;
+uniform float threshold;
+
+vec4 sampleGlow(vec2 uv)
+{
+    vec4 color = texture2D(texture, uv);
+    if (!applyThreshold)
+        return color;
+    float brightness = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+    float amount = clamp((brightness - threshold) / (1.0 - threshold), 0.0, 1.0);
+    return vec4(color.rgb * amount, color.a);
+}
 
 void main()
 {
     vec2 uv = gl_TexCoord[0].xy;
     vec2 texel = direction / resolution;
 
-    // macOS-safe weights
-    float w0 = 0.227027;
-    float w1 = 0.1945946;
-    float w2 = 0.1216216;
-    float w3 = 0.054054;
-    float w4 = 0.016216;
-
-    vec4 color = texture2D(texture, uv) * w0;
-
-    float off;
-    vec2 offset;
-
-    off = 1.0 * radius;
-    offset = texel * off;
-    color += texture2D(texture, clamp(uv + offset, 0.0, 1.0)) * w1;
-    color += texture2D(texture, clamp(uv - offset, 0.0, 1.0)) * w1;
-
-    off = 2.0 * radius;
-    offset = texel * off;
-    color += texture2D(texture, clamp(uv + offset, 0.0, 1.0)) * w2;
-    color += texture2D(texture, clamp(uv - offset, 0.0, 1.0)) * w2;
-
-    off = 3.0 * radius;
-    offset = texel * off;
-    color += texture2D(texture, clamp(uv + offset, 0.0, 1.0)) * w3;
-    color += texture2D(texture, clamp(uv - offset, 0.0, 1.0)) * w3;
-
-    off = 4.0 * radius;
-    offset = texel * off;
-    color += texture2D(texture, clamp(uv + offset, 0.0, 1.0)) * w4;
-    color += texture2D(texture, clamp(uv - offset, 0.0, 1.0)) * w4;
+    vec4 color = sampleGlow(uv) * weights[0];
+    // Constant loop bound, macOS-safe
+    for (int i = 1; i < 32; i++)
+    {
+        if (i >= tapCount)
+            break;
+        vec2 offset = texel * offsets[i];
+        color += sampleGlow(clamp(uv + offset, 0.0, 1.0)) * weights[i];
+        color += sampleGlow(clamp(uv - offset, 0.0, 1.0)) * weights[i];
+    }
 
     gl_FragColor = color * bloomIntensity;
-}
\ No newline at end of file
+}
@@ -0,0 +1,74 @@
+// noteMesh.frag
+// Rounded, outlined note drawn as a signed distance field over a single quad.
+// u_mode: 0 = textured note with outline, 1 = solid glow shape, 2 = hollow negative,
+//         3 = pre-blurred glow, the product of two rows of the glow slice texture
+
+uniform sampler2D u_texture;
+uniform vec4 u_texRect;
+uniform vec4 u_fillColors[12];
+uniform vec4 u_outlineColors[12];
+uniform vec4 u_glowColors[12];
+uniform float u_outlineWidth;
+uniform float u_cornerRadius;
+uniform int u_mode;
+uniform sampler2D u_glowSlice;
+uniform vec2 u_sliceSize;
+uniform float u_sliceExtent;
+
+varying vec2 v_local;
+varying vec2 v_size;
+varying float v_noteInOctave;
+
+float roundedBoxDistance(vec2 p, vec2 halfSize, float radius)
+{
+    radius = min(radius, min(halfSize.x, halfSize.y));
+    vec2 q = abs(p) - halfSize + vec2(radius);
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+// Blurred segment across 'span' (the segment and its padding), same mapping as
+// VPianoResources::getGlowSliceTexel
+float glowProfile(float t, float span)
+{
+    float edge = 2.0 * u_sliceExtent;
+    float length = span - edge;
+    float rowLength = clamp(floor(length + 0.5), 1.0, u_sliceSize.y);
+    float rowSpan = rowLength + edge;
+    float u = t * rowSpan / span;
+    if (length > u_sliceSize.y)
+        u = (t < span * 0.5 ? min(t, edge) : rowSpan - min(span - t, edge));
+    return texture2D(u_glowSlice, vec2(u, rowLength - 0.5) / u_sliceSize).a;
+}
+
+void main()
+{
+    int noteIndex = int(v_noteInOctave + 0.5);
+    if (u_mode == 3)
+    {
+        float falloff = glowProfile(v_local.x, v_size.x) * glowProfile(v_local.y, v_size.y);
+        gl_FragColor = u_glowColors[noteIndex] * falloff;
+        return;
+    }
+    vec2 halfSize = v_size * 0.5;
+    float dist = roundedBoxDistance(v_local - halfSize, halfSize, u_cornerRadius);
+    float coverage = clamp(0.5 - dist, 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+
+    vec4 color;
+    if (u_mode == 0)
+    {
+        vec2 uv = u_texRect.xy + (v_local / max(v_size, vec2(1.0))) * u_texRect.zw;
+        vec4 fill = u_fillColors[noteIndex] * texture2D(u_texture, uv);
+        vec4 outline = u_outlineColors[noteIndex];
+        float border = clamp(dist + u_outlineWidth + 0.5, 0.0, 1.0);
+        vec4 bordered = vec4(mix(fill.rgb, outline.rgb, outline.a), max(fill.a, outline.a));
+        color = mix(fill, bordered, border);
+    }
+    else if (u_mode == 1)
+        color = u_glowColors[noteIndex];
+    else
+        color = vec4(0.0, 0.0, 0.0, 1.0);
+
+    gl_FragColor = vec4(color.rgb, color.a * coverage);
+}
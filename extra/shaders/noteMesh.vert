@@ -0,0 +1,32 @@
+// noteMesh.vert
+// Vertices are baked once per song: x in unscaled piano space, y as the song time
+// of the note edge. The note bottom reaches the keyboard exactly at its start time.
+
+uniform float u_time;
+uniform float u_pps;
+uniform float u_vpy;
+uniform float u_scaleX;
+uniform float u_noteWidth;
+uniform vec4 u_margins; // left, top, right, bottom, in pixels
+
+varying vec2 v_local;
+varying vec2 v_size;
+varying float v_noteInOctave;
+
+void main()
+{
+    // texCoord.x: 0 = left edge, 1 = right edge
+    // texCoord.y: note duration, negative on the top edge and positive on the bottom edge
+    float right = step(0.5, gl_MultiTexCoord0.x);
+    float bottom = step(0.0, gl_MultiTexCoord0.y);
+    float height = abs(gl_MultiTexCoord0.y) * u_pps;
+
+    float x = gl_Vertex.x * u_scaleX + mix(-u_margins.x, u_margins.z, right);
+    float y = u_vpy - (gl_Vertex.y - u_time) * u_pps + mix(-u_margins.y, u_margins.w, bottom);
+
+    v_size = vec2(u_noteWidth + u_margins.x + u_margins.z, height + u_margins.y + u_margins.w);
+    v_local = vec2(right, bottom) * v_size;
+    v_noteInOctave = gl_Color.r * 255.0;
+
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(x, y, 0.0, 1.0);
+}
@@ -0,0 +1,228 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AnalyticParticles.hpp"
+#include "Common.hpp"
+#include "Renderer.hpp"
+#include <ostd/Logger.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+void AnalyticParticles::create(ParticleEmitter& reference, size_t capacity)
+{
+	destroy();
+	m_info = reference.getDefaultParticleInfo();
+	m_colorLUT = reference.getColorLUT();
+	m_lutDirty = true;
+
+	auto tileCoords = [this](TextureRef::TextureAtlasIndex index) {
+		TextureRef::tTexCoords uv;
+		if (m_info.texture != nullptr)
+			uv = m_info.texture->getTile(index);
+		return sf::Glsl::Vec4(uv.topLeft.x, uv.topLeft.y, uv.bottomRight.x, uv.bottomRight.y);
+	};
+	const auto& tileArray = reference.getTileArray();
+	if (reference.isTileArrayUsed() && tileArray.size() > 0)
+	{
+		if (tileArray.size() > MaxTiles)
+			OX_WARN("Analytic particles support up to %d tiles, the rest of the tile array is ignored.", (int32_t)MaxTiles);
+		for (size_t i = 0; i < std::min(tileArray.size(), MaxTiles); i++)
+			m_tiles.push_back(tileCoords(tileArray[i]));
+	}
+	else
+		m_tiles.push_back(tileCoords(m_info.tileIndex));
+
+	m_maxLifeFrames = m_info.maxLifeFrames();
+	m_capacity = capacity;
+	reset();
+}
+
+void AnalyticParticles::destroy(void)
+{
+	m_capacity = 0;
+	m_tiles.clear();
+	m_colorLUT = nullptr;
+	m_pending.clear();
+	m_frameStarts.clear();
+	m_buffer = sf::VertexBuffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream);
+	m_spawned = 0;
+	m_uploaded = 0;
+	m_frame = 0;
+}
+
+void AnalyticParticles::reset(void)
+{
+	m_pending.clear();
+	m_frameStarts.clear();
+	m_spawned = 0;
+	m_uploaded = 0;
+	m_frame = 0;
+}
+
+void AnalyticParticles::step(void)
+{
+	if (!isCreated()) return;
+	m_frame++;
+	m_frameStarts.push_back({ m_frame, m_spawned });
+	while (!m_frameStarts.empty() && (float)(m_frame - m_frameStarts.front().first) > m_maxLifeFrames)
+		m_frameStarts.pop_front();
+}
+
+void AnalyticParticles::spawn(ParticleEmitter& emitter, const ostd::Vec2& force, int32_t count)
+{
+	if (!isCreated() || count <= 0) return;
+	// Same scaling and limit as ParticleEmitter::update, stored as a fraction of the limit
+	float maxAccel = 2.0f * Common::deltaTime;
+	ostd::Vec2 accel = force;
+	accel *= Common::deltaTime;
+	accel.limit(maxAccel);
+	auto encode = [maxAccel](float a) {
+		return (uint8_t)(128.0f + std::round(std::clamp(a / maxAccel, -1.0f, 1.0f) * 127.0f));
+	};
+	auto& random = emitter.getRandom();
+	for (int32_t i = 0; i < count; i++)
+	{
+		tSpawn spawn;
+		spawn.frame = (float)m_frame;
+		spawn.position = emitter.getEmissionRect().getPosition() + emitter.getRandomEmissionPoint();
+		spawn.seed = (float)random.geti32(0, SeedRange - 1);
+		spawn.accelX = encode(accel.x);
+		spawn.accelY = encode(accel.y);
+		m_pending.push_back(spawn);
+	}
+	m_spawned += count;
+	// Without a draw in between, only the newest particles still fit in the ring
+	if (m_pending.size() > m_capacity)
+		m_pending.erase(m_pending.begin(), m_pending.begin() + (m_pending.size() - m_capacity));
+}
+
+void AnalyticParticles::draw(sf::Shader& shader)
+{
+	if (!isCreated() || !sf::VertexBuffer::isAvailable()) return;
+	__upload_pending();
+	__update_lut_texture();
+	uint64_t oldest = m_uploaded;
+	if (!m_frameStarts.empty())
+		oldest = m_frameStarts.front().second;
+	if (m_uploaded > m_capacity)
+		oldest = std::max(oldest, m_uploaded - m_capacity);
+	if (oldest >= m_uploaded) return;
+
+	__set_uniforms(shader);
+	Renderer::useTexture(nullptr);
+	Renderer::useShader(&shader);
+	size_t first = (size_t)(oldest % m_capacity);
+	size_t count = (size_t)(m_uploaded - oldest);
+	size_t firstRun = std::min(count, m_capacity - first);
+	Renderer::drawVertexBuffer(m_buffer, first * 6, firstRun * 6);
+	if (count > firstRun)
+		Renderer::drawVertexBuffer(m_buffer, 0, (count - firstRun) * 6);
+	Renderer::useShader(nullptr);
+}
+
+void AnalyticParticles::__upload_pending(void)
+{
+	if (m_buffer.getVertexCount() != m_capacity * 6)
+	{
+		if (!m_buffer.create(m_capacity * 6))
+		{
+			OX_WARN("Unable to allocate the analytic particle buffer (%d particles).", (int32_t)m_capacity);
+			return;
+		}
+	}
+	// Spawns dropped from the pending list never reach the buffer, but still count as written
+	m_uploaded = m_spawned - m_pending.size();
+	size_t done = 0;
+	while (done < m_pending.size())
+	{
+		size_t slot = (size_t)(m_uploaded % m_capacity);
+		size_t run = std::min(m_pending.size() - done, m_capacity - slot);
+		m_scratch.resize(run * 6);
+		for (size_t i = 0; i < run; i++)
+			__write_quad(m_pending[done + i], &m_scratch[i * 6]);
+		if (!m_buffer.update(m_scratch.data(), run * 6, (unsigned int)(slot * 6)))
+			OX_WARN("Unable to upload analytic particles.");
+		m_uploaded += run;
+		done += run;
+	}
+	m_pending.clear();
+}
+
+void AnalyticParticles::__update_lut_texture(void)
+{
+	if (!m_lutDirty) return;
+	m_lutDirty = false;
+	if (m_colorLUT == nullptr) return;
+	std::array<uint8_t, tColorLUT::Size * 4> pixels;
+	for (size_t i = 0; i < tColorLUT::Size; i++)
+	{
+		const auto& color = m_colorLUT->colors[i];
+		pixels[i * 4 + 0] = color.r;
+		pixels[i * 4 + 1] = color.g;
+		pixels[i * 4 + 2] = color.b;
+		pixels[i * 4 + 3] = color.a;
+	}
+	if (!m_lutTexture.resize({ (uint32_t)tColorLUT::Size, 1 }))
+	{
+		OX_WARN("Unable to create the particle colour table texture.");
+		m_colorLUT = nullptr;
+		return;
+	}
+	m_lutTexture.update(pixels.data());
+}
+
+void AnalyticParticles::__set_uniforms(sf::Shader& shader)
+{
+	shader.setUniform("u_time", (float)m_frame);
+	shader.setUniform("u_lifeSpan", m_info.lifeSpan);
+	shader.setUniform("u_randomLifeSpan", m_info.randomLifeSpan);
+	shader.setUniform("u_speed", m_info.speed);
+	shader.setUniform("u_randomSpeed", m_info.randomSpeed);
+	shader.setUniform("u_angle", m_info.angle);
+	shader.setUniform("u_randomDirection", m_info.randomDirection);
+	shader.setUniform("u_allDirections", m_info.allDirections ? 1.0f : 0.0f);
+	shader.setUniform("u_randomVelocity", sf::Glsl::Vec2(m_info.randomVelocity.x, m_info.randomVelocity.y));
+	shader.setUniform("u_size", sf::Glsl::Vec2(m_info.size.x, m_info.size.y));
+	shader.setUniform("u_randomSize", sf::Glsl::Vec2(m_info.randomSize.x, m_info.randomSize.y));
+	shader.setUniform("u_damping", sf::Glsl::Vec2(m_info.damping.x, m_info.damping.y));
+	shader.setUniform("u_randomDamping", m_info.randomDamping ? 1.0f : 0.0f);
+	shader.setUniform("u_color", sf::Glsl::Vec4(m_info.color.r, m_info.color.g, m_info.color.b, m_info.color.a));
+	shader.setUniform("u_randomAlpha", m_info.randomAlpha);
+	shader.setUniform("u_fadeIn", m_info.fadeIn ? 1.0f : 0.0f);
+	shader.setUniform("u_maxAccel", (float)(2.0 * Common::deltaTime));
+	shader.setUniform("u_useColorLUT", m_colorLUT != nullptr ? 1.0f : 0.0f);
+	shader.setUniform("u_lutAgeScale", m_colorLUT != nullptr ? m_colorLUT->ageScale : 0.0f);
+	if (m_colorLUT != nullptr)
+		shader.setUniform("u_colorLUT", m_lutTexture);
+	shader.setUniformArray("u_tiles", m_tiles.data(), m_tiles.size());
+	shader.setUniform("u_tileCount", (float)m_tiles.size());
+}
+
+void AnalyticParticles::__write_quad(const tSpawn& spawn, sf::Vertex* out)
+{
+	// The vertex colour carries the quad corner and the force, see analyticParticle.vert
+	for (uint8_t corner = 0; corner < 6; corner++)
+	{
+		out[corner].position = { spawn.position.x, spawn.position.y };
+		out[corner].texCoords = { spawn.frame, spawn.seed };
+		out[corner].color = sf::Color(corner, spawn.accelX, spawn.accelY, 255);
+	}
+}
@@ -0,0 +1,91 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <SFML/Graphics/Shader.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "Particles.hpp"
+
+// Particles that are never simulated on the CPU. Emitting only records a spawn event
+// (frame, seed, position, force) into a ring of quads in a stream vertex buffer, and
+// shaders/analyticParticle.vert evaluates each particle in closed form from its age.
+// The force is the one at spawn time and the velocity is not clamped, so the motion
+// can differ slightly from ParticleEmitter.
+class AnalyticParticles
+{
+	private: struct tSpawn
+	{
+		float frame { 0.0f };
+		float seed { 0.0f };
+		ostd::Vec2 position { 0.0f, 0.0f };
+		uint8_t accelX { 128 };
+		uint8_t accelY { 128 };
+	};
+
+	public:
+		// Takes the particle info, tiles and colour ramp of the reference emitter
+		void create(ParticleEmitter& reference, size_t capacity);
+		void destroy(void);
+		void reset(void);
+		// Advances the particle clock by one update
+		void step(void);
+		void spawn(ParticleEmitter& emitter, const ostd::Vec2& force, int32_t count);
+		// Uploads pending spawns, sets the uniforms and draws, on the render thread.
+		// The particle texture uniform (u_texture) is left to the caller
+		void draw(sf::Shader& shader);
+
+		inline bool isCreated(void) const { return m_capacity > 0; }
+		inline uint64_t getFrame(void) const { return m_frame; }
+		inline size_t getCapacity(void) const { return m_capacity; }
+
+	private:
+		void __upload_pending(void);
+		void __update_lut_texture(void);
+		void __set_uniforms(sf::Shader& shader);
+		void __write_quad(const tSpawn& spawn, sf::Vertex* out);
+
+	private:
+		tParticleInfo m_info;
+		std::vector<sf::Glsl::Vec4> m_tiles;
+		std::shared_ptr<const tColorLUT> m_colorLUT;
+		sf::Texture m_lutTexture;
+		bool m_lutDirty { false };
+
+		std::vector<tSpawn> m_pending;
+		std::vector<sf::Vertex> m_scratch;
+		sf::VertexBuffer m_buffer { sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream };
+		// Particles are written in order, slot = index % m_capacity
+		size_t m_capacity { 0 };
+		uint64_t m_spawned { 0 };
+		uint64_t m_uploaded { 0 };
+		uint64_t m_frame { 0 };
+		float m_maxLifeFrames { 0.0f };
+		// Spawn count at the start of each frame that can still have live particles
+		std::deque<std::pair<uint64_t, uint64_t>> m_frameStarts;
+
+	public:
+		inline static constexpr size_t MaxTiles { 32 };
+		inline static constexpr int32_t SeedRange { 65536 };
+};
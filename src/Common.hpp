@@ -66,7 +66,10 @@ class Common
 		inline static const ostd::json DefaultSettingsJSON = R"({
 						"settings": {
 							"useSystenFFMPEG": true,
-							"ffmpegPath": "./ffmpeg/"
+							"ffmpegPath": "./ffmpeg/",
+							"dynamicResolution": true,
+							"frameBudget_ms": 18.0,
+							"particleGovernor": true
 						}
 		})"_json;
 
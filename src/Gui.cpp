@@ -241,6 +241,12 @@ void Gui::showVideoRenderingGui(void)
 	m_renderingProgressBar->setValue(0);
 }
 
+void Gui::hideVideoRenderingGui(void)
+{
+	m_isRenderingVideo = false;
+	m_renderingProgressBar->setVisible(false);
+}
+
 void Gui::draw(void)
 {
 	if (!isValid()) return;
@@ -365,6 +371,12 @@ void Gui::__draw_sidebar(void)
 void Gui::__draw_videoRenderGui(void)
 {
 	if (!m_isRenderingVideo) return;
+	// The export may have finished earlier in this frame, releasing its target
+	if (!m_videoRenderState->virtualPiano.getVideoRenderer().isRenderingToFile())
+	{
+		hideVideoRenderingGui();
+		return;
+	}
 	auto padx = [](float pad, const ostd::String& str, uint32_t fontSize) -> float {
 		return Common::scaleX(pad) + Renderer::getStringSize(str, fontSize).x;
 	};
@@ -444,10 +456,13 @@ void Gui::__draw_videoRenderGui(void)
 	pos.x -= Common::scaleX(Renderer::getStringSize(label, fontSize).x - 2);
 	Renderer::drawString(label, pos, color1, fontSize);
 
-	Renderer::drawTexture(vrs.flippedRenderTarget.getTexture(), { pbpos.x, pos.y + Common::scaleY(110) }, { Common::scaleXY(0.2f), Common::scaleXY(0.2f) }, { 140, 140, 140 });
-	auto tmpSize = vrs.flippedRenderTarget.getTexture().getSize();
-	ostd::Vec2 previewSize = { (float)tmpSize.x * Common::scaleXY(0.2f), (float)tmpSize.y * Common::scaleXY(0.2f) };
-	Renderer::drawRoundedRect({ pbpos.x, pos.y + Common::scaleY(110), previewSize.x, previewSize.y }, { 140, 20, 120, 230 }, { 5, 5, 5, 5 }, 3);
+	if (vrs.renderTarget != nullptr)
+	{
+		Renderer::drawTexture(vrs.renderTarget->getTexture(), { pbpos.x, pos.y + Common::scaleY(110) }, { Common::scaleXY(0.2f), Common::scaleXY(0.2f) }, { 140, 140, 140 });
+		auto tmpSize = vrs.renderTarget->getTexture().getSize();
+		ostd::Vec2 previewSize = { (float)tmpSize.x * Common::scaleXY(0.2f), (float)tmpSize.y * Common::scaleXY(0.2f) };
+		Renderer::drawRoundedRect({ pbpos.x, pos.y + Common::scaleY(110), previewSize.x, previewSize.y }, { 140, 20, 120, 230 }, { 5, 5, 5, 5 }, 3);
+	}
 
 	pos = { guiBounds.x, pos.y + Common::scaleY(40) };
 	Renderer::fillRect({ pos.x, pos.y, guiBounds.w, 2 }, { 120, 120, 120, 120 });
@@ -77,6 +77,7 @@ class Gui : public ostd::BaseObject
 		void showFileDialog(const ostd::String& title, const FileDialogFilterList& filters, std::function<void(const std::vector<ostd::String>&, bool)> callback, bool multiselect = false);
 		void showColorPicker(const ostd::String& title, const ostd::Color& setColor, const ostd::Vec2& position, std::function<void(const ostd::Color&)> callback);
 		void showVideoRenderingGui(void);
+		void hideVideoRenderingGui(void);
 		void draw(void);
 
 		inline bool isVisible(void) const { return m_visible; }
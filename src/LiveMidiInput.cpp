@@ -0,0 +1,197 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LiveMidiInput.hpp"
+#include "Common.hpp"
+#include "MidiLoader.hpp"
+#include <ostd/Logger.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+LiveMidiInput::~LiveMidiInput(void)
+{
+	close();
+}
+
+bool LiveMidiInput::open(const ostd::String& source)
+{
+	close();
+	m_queue.clear();
+	m_droppedEvents.store(0, std::memory_order_relaxed);
+	m_disconnected.store(false, std::memory_order_release);
+	if (source.new_trim().endsWith(".mid"))
+	{
+		m_running.store(true, std::memory_order_release);
+		m_sourceType = eSourceType::FileReplay;
+		m_thread = std::thread(&LiveMidiInput::__file_replay_thread, this, source.new_trim());
+		OX_DEBUG("Live MIDI input: replaying <%s>.", source.c_str());
+		return true;
+	}
+#ifdef _WIN32
+	OX_ERROR("Live MIDI input from devices is not supported on this platform: %s", source.c_str());
+	return false;
+#else
+	struct stat st;
+	if (stat(source.c_str(), &st) != 0)
+	{
+		OX_ERROR("Live MIDI input source not found: %s", source.c_str());
+		return false;
+	}
+	// A FIFO opened read-only reports EOF whenever no writer is attached, so it is
+	// opened read-write to keep it alive between test sessions
+	int32_t fd = ::open(source.c_str(), (S_ISFIFO(st.st_mode) ? O_RDWR : O_RDONLY) | O_NONBLOCK);
+	if (fd < 0)
+	{
+		OX_ERROR("Unable to open live MIDI input: %s", source.c_str());
+		return false;
+	}
+	m_runningStatus = 0;
+	m_dataCount = 0;
+	m_inSysex = false;
+	m_running.store(true, std::memory_order_release);
+	m_sourceType = eSourceType::RawStream;
+	m_thread = std::thread(&LiveMidiInput::__raw_stream_thread, this, fd);
+	OX_DEBUG("Live MIDI input: reading from <%s>.", source.c_str());
+	return true;
+#endif
+}
+
+void LiveMidiInput::close(void)
+{
+	m_running.store(false, std::memory_order_release);
+	if (m_thread.joinable())
+		m_thread.join();
+	m_sourceType = eSourceType::None;
+}
+
+void LiveMidiInput::__raw_stream_thread(int32_t fd)
+{
+#ifndef _WIN32
+	uint8_t buffer[256];
+	pollfd pfd { fd, POLLIN, 0 };
+	while (m_running.load(std::memory_order_acquire))
+	{
+		// Blocking wait instead of polling on a timer, so an event is queued as soon as the
+		// driver delivers it. The timeout only bounds how long close() has to wait
+		int32_t ready = ::poll(&pfd, 1, 50);
+		if (ready <= 0) continue;
+		if ((pfd.revents & POLLIN) == 0)
+		{
+			// Unplugged devices report a hang-up or an error instead of data
+			if ((pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0)
+				break;
+			continue;
+		}
+		ssize_t count = ::read(fd, buffer, sizeof(buffer));
+		if (count < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+		if (count <= 0) break;
+		for (ssize_t i = 0; i < count; i++)
+			__parse_byte(buffer[i]);
+	}
+	if (m_running.load(std::memory_order_acquire))
+		m_disconnected.store(true, std::memory_order_release);
+	::close(fd);
+#endif
+}
+
+void LiveMidiInput::__file_replay_thread(ostd::String filePath)
+{
+	MidiLoader::tResult result;
+	if (!MidiLoader::loadFile(filePath, 0.0, result))
+	{
+		OX_ERROR("Unable to load live replay file: %s", filePath.c_str());
+		return;
+	}
+	std::vector<tLiveMidiEvent> events;
+	events.reserve(result.notes.size() * 2);
+	for (const auto& note : result.notes)
+	{
+		events.push_back({ note.startTime * 1e9, note.pitch, note.velocity, true });
+		events.push_back({ note.endTime() * 1e9, note.pitch, 0, false });
+	}
+	// Offs before ons at the same time, so repeated notes are released before being struck again
+	std::stable_sort(events.begin(), events.end(), [](const tLiveMidiEvent& a, const tLiveMidiEvent& b) {
+		if (a.timestamp_ns != b.timestamp_ns) return a.timestamp_ns < b.timestamp_ns;
+		return !a.noteOn && b.noteOn;
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	for (const auto& evt : events)
+	{
+		auto due = start + std::chrono::nanoseconds((int64_t)evt.timestamp_ns);
+		while (m_running.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < due)
+			std::this_thread::sleep_until(std::min(due, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+		if (!m_running.load(std::memory_order_acquire)) return;
+		__push_event(evt.noteOn ? 0x90 : 0x80, evt.pitch, evt.velocity);
+	}
+}
+
+void LiveMidiInput::__parse_byte(uint8_t byte)
+{
+	if (byte >= 0xF8) return; // Real-time messages may appear anywhere, even inside other messages
+	if (byte == 0xF0)
+	{
+		m_inSysex = true;
+		m_runningStatus = 0;
+		return;
+	}
+	if (byte == 0xF7)
+	{
+		m_inSysex = false;
+		return;
+	}
+	if (byte & 0x80)
+	{
+		m_inSysex = false;
+		// System common messages cancel running status and carry nothing we need
+		m_runningStatus = (byte < 0xF0 ? byte : 0);
+		m_dataCount = 0;
+		return;
+	}
+	if (m_inSysex || m_runningStatus == 0) return;
+
+	uint8_t type = m_runningStatus & 0xF0;
+	uint8_t needed = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+	m_dataBytes[m_dataCount++] = byte;
+	if (m_dataCount < needed) return;
+	m_dataCount = 0;
+	if (type == 0x90 || type == 0x80)
+		__push_event(m_runningStatus, m_dataBytes[0], m_dataBytes[1]);
+}
+
+void LiveMidiInput::__push_event(uint8_t status, uint8_t pitch, uint8_t velocity)
+{
+	if (pitch < MidiLoader::LowestPianoKey || pitch > MidiLoader::HighestPianoKey) return;
+	tLiveMidiEvent evt;
+	evt.timestamp_ns = Common::getCurrentTIme_ns();
+	evt.pitch = pitch;
+	evt.velocity = velocity;
+	evt.noteOn = ((status & 0xF0) == 0x90 && velocity > 0);
+	if (!m_queue.push(evt))
+		m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostd/String.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "SPSCQueue.hpp"
+
+struct tLiveMidiEvent
+{
+	double timestamp_ns { 0.0 };
+	uint8_t pitch { 0 };
+	uint8_t velocity { 0 };
+	bool noteOn { false };
+};
+
+// Reads note events on a dedicated thread and hands them to the render thread
+// through a lock-free queue. The source is either a raw MIDI byte stream
+// (/dev/snd/midiC*D*, /dev/midi*, or a named pipe) or a .mid file that is
+// replayed in real time as a stand-in for a keyboard.
+class LiveMidiInput
+{
+	public: enum class eSourceType { None = 0, RawStream, FileReplay };
+	public: struct tLatencyStats
+	{
+		double sum_ms { 0.0 };
+		double max_ms { 0.0 };
+		double last_ms { 0.0 };
+		double frameTimeSum_ms { 0.0 };
+		int32_t samples { 0 };
+		int32_t frames { 0 };
+	};
+
+	public:
+		inline LiveMidiInput(void) {  }
+		~LiveMidiInput(void);
+		LiveMidiInput(const LiveMidiInput&) = delete;
+		LiveMidiInput& operator=(const LiveMidiInput&) = delete;
+
+		bool open(const ostd::String& source);
+		void close(void);
+		inline bool poll(tLiveMidiEvent& outEvent) { return m_queue.pop(outEvent); }
+		inline bool isOpen(void) const { return m_sourceType != eSourceType::None; }
+		// The device went away, the input thread has stopped reading
+		inline bool isDisconnected(void) const { return m_disconnected.load(std::memory_order_acquire); }
+		inline eSourceType getSourceType(void) const { return m_sourceType; }
+		inline uint64_t getDroppedEventCount(void) const { return m_droppedEvents.load(std::memory_order_relaxed); }
+
+	private:
+		void __raw_stream_thread(int32_t fd);
+		void __file_replay_thread(ostd::String filePath);
+		void __parse_byte(uint8_t byte);
+		void __push_event(uint8_t status, uint8_t pitch, uint8_t velocity);
+
+	private:
+		SPSCQueue<tLiveMidiEvent, 4096> m_queue;
+		std::thread m_thread;
+		std::atomic<bool> m_running { false };
+		std::atomic<bool> m_disconnected { false };
+		std::atomic<uint64_t> m_droppedEvents { 0 };
+		eSourceType m_sourceType { eSourceType::None };
+
+		// Raw stream parser state, only touched by the input thread
+		uint8_t m_runningStatus { 0 };
+		uint8_t m_dataBytes[2] { 0, 0 };
+		uint8_t m_dataCount { 0 };
+		bool m_inSysex { false };
+};
@@ -0,0 +1,385 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MidiLoader.hpp"
+#include "ThreadPool.hpp"
+#include <ostd/Logger.hpp>
+#include <ostd/Midi.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <functional>
+#include <tuple>
+
+namespace
+{
+	inline uint32_t read_be32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]; }
+	inline uint16_t read_be16(const uint8_t* p) { return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]); }
+
+	inline bool read_vlq(const uint8_t* data, size_t size, size_t& pos, uint32_t& outValue)
+	{
+		outValue = 0;
+		for (int32_t i = 0; i < 4; i++)
+		{
+			if (pos >= size) return false;
+			uint8_t b = data[pos++];
+			outValue = (outValue << 7) | (b & 0x7F);
+			if ((b & 0x80) == 0) return true;
+		}
+		return false;
+	}
+}
+
+bool MidiLoader::loadFile(const ostd::String& filePath, double timeOffset, tResult& outResult)
+{
+	std::ifstream in(filePath.cpp_str(), std::ios::binary | std::ios::ate);
+	if (!in) return false;
+	std::streamsize fileSize = in.tellg();
+	if (fileSize <= 0) return false;
+	std::vector<uint8_t> buffer((size_t)fileSize);
+	in.seekg(0);
+	if (!in.read(reinterpret_cast<char*>(buffer.data()), fileSize)) return false;
+	return parseBuffer(buffer.data(), buffer.size(), timeOffset, outResult);
+}
+
+bool MidiLoader::parseBuffer(const uint8_t* data, size_t size, double timeOffset, tResult& outResult)
+{
+	outResult = tResult();
+	if (size < 14 || std::memcmp(data, "MThd", 4) != 0) return false;
+	uint32_t headerLength = read_be32(data + 4);
+	if (headerLength < 6 || 8 + (size_t)headerLength > size) return false;
+	uint16_t division = read_be16(data + 12);
+	if (division == 0) return false;
+
+	// Locating the chunks is cheap and has to be sequential, the decoding is not
+	std::vector<tTrack> tracks;
+	size_t pos = 8 + headerLength;
+	while (pos + 8 <= size)
+	{
+		uint32_t chunkLength = read_be32(data + pos + 4);
+		size_t chunkStart = pos + 8;
+		size_t available = std::min((size_t)chunkLength, size - chunkStart);
+		if (std::memcmp(data + pos, "MTrk", 4) == 0)
+		{
+			tTrack track;
+			track.data = data + chunkStart;
+			track.size = available;
+			tracks.push_back(std::move(track));
+		}
+		pos = chunkStart + available;
+	}
+	if (tracks.empty()) return false;
+	outResult.trackCount = (int32_t)tracks.size();
+
+	ThreadPool::shared().parallelFor(tracks.size(), 1, [&tracks](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			__decode_track(tracks[i]);
+	});
+	for (auto& track : tracks)
+	{
+		if (!track.valid) return false;
+	}
+
+	std::vector<tTempoEvent> tempoMap;
+	__build_tempo_map(tracks, tempoMap);
+
+	ThreadPool::shared().parallelFor(tracks.size(), 1, [&tracks, &tempoMap, division, timeOffset](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			auto& track = tracks[i];
+			track.notes.reserve(track.rawNotes.size());
+			for (const auto& raw : track.rawNotes)
+			{
+				if (raw.pitch < LowestPianoKey || raw.pitch > HighestPianoKey) continue;
+				double startTime = __tick_to_seconds(raw.startTick, tempoMap, division);
+				double endTime = __tick_to_seconds(raw.endTick, tempoMap, division);
+				PackedNote note;
+				note.startTime = (float)(startTime + timeOffset);
+				note.duration = (float)(endTime - startTime);
+				note.pitch = raw.pitch;
+				note.velocity = raw.velocity;
+				note.track = (uint16_t)std::min(i, (size_t)std::numeric_limits<uint16_t>::max());
+				track.notes.push_back(note);
+			}
+			track.rawNotes.clear();
+			track.rawNotes.shrink_to_fit();
+		}
+	});
+
+	__merge_tracks(tracks, outResult);
+	return true;
+}
+
+void MidiLoader::runLoadBenchmark(const ostd::String& directory, int32_t iterations)
+{
+	std::vector<std::filesystem::path> files;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory.cpp_str(), ec))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".mid")
+			files.push_back(entry.path());
+	}
+	std::sort(files.begin(), files.end());
+	if (files.empty())
+	{
+		OX_WARN("No .mid files found in <%s>.", directory.c_str());
+		return;
+	}
+	iterations = std::max(iterations, 1);
+
+	auto l_measure = [iterations](const std::function<size_t(void)>& func, double& outMin, double& outMean) -> size_t {
+		size_t count = 0;
+		outMin = std::numeric_limits<double>::max();
+		outMean = 0.0;
+		for (int32_t i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			count = func();
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			outMin = std::min(outMin, elapsed);
+			outMean += elapsed / iterations;
+		}
+		return count;
+	};
+
+	OX_DEBUG("MIDI load benchmark: %d files, %d iterations, %d threads.", (int32_t)files.size(), iterations, (int32_t)ThreadPool::shared().getThreadCount());
+	double totalSerial = 0.0, totalParallel = 0.0;
+	for (const auto& file : files)
+	{
+		ostd::String path = file.string();
+		double serialMin = 0.0, serialMean = 0.0, parallelMin = 0.0, parallelMean = 0.0;
+		size_t serialCount = l_measure([&path]() -> size_t {
+			auto events = ostd::MidiParser::parseFile(path);
+			std::sort(events.begin(), events.end());
+			return events.size();
+		}, serialMin, serialMean);
+		int32_t trackCount = 0;
+		size_t parallelCount = l_measure([&path, &trackCount]() -> size_t {
+			tResult result;
+			loadFile(path, 0.0, result);
+			trackCount = result.trackCount;
+			return result.notes.size();
+		}, parallelMin, parallelMean);
+		totalSerial += serialMean;
+		totalParallel += parallelMean;
+		OX_DEBUG("  %s: %d tracks, %d/%d notes | ostd+sort min %.3f ms avg %.3f ms | MidiLoader min %.3f ms avg %.3f ms",
+				 file.filename().string().c_str(), trackCount, (int32_t)serialCount, (int32_t)parallelCount, serialMin, serialMean, parallelMin, parallelMean);
+	}
+	OX_DEBUG("  Total (avg): ostd+sort %.3f ms | MidiLoader %.3f ms", totalSerial, totalParallel);
+}
+
+void MidiLoader::__decode_track(tTrack& track)
+{
+	const uint8_t* data = track.data;
+	size_t size = track.size;
+	size_t pos = 0;
+	uint64_t tick = 0;
+	uint8_t status = 0;
+	// Open notes are chained per channel/pitch, so overlapping repeats are closed in FIFO order
+	std::array<int32_t, 16 * 128> openHead;
+	std::array<int32_t, 16 * 128> openTail;
+	openHead.fill(-1);
+	openTail.fill(-1);
+	track.rawNotes.reserve(size / 6);
+
+	while (pos < size)
+	{
+		uint32_t delta = 0;
+		if (!read_vlq(data, size, pos, delta) || pos >= size)
+		{
+			track.valid = false;
+			return;
+		}
+		tick += delta;
+		uint8_t b = data[pos];
+		if (b == 0xFF)
+		{
+			if (pos + 2 > size)
+			{
+				track.valid = false;
+				return;
+			}
+			uint8_t type = data[pos + 1];
+			pos += 2;
+			uint32_t length = 0;
+			if (!read_vlq(data, size, pos, length) || pos + length > size)
+			{
+				track.valid = false;
+				return;
+			}
+			if (type == 0x51 && length == 3)
+			{
+				tTempoEvent tempo;
+				tempo.tick = tick;
+				tempo.usPerQuarter = ((uint32_t)data[pos] << 16) | ((uint32_t)data[pos + 1] << 8) | (uint32_t)data[pos + 2];
+				track.tempoEvents.push_back(tempo);
+			}
+			pos += length;
+			if (type == 0x2F) break;
+			continue;
+		}
+		if (b == 0xF0 || b == 0xF7)
+		{
+			pos++;
+			uint32_t length = 0;
+			if (!read_vlq(data, size, pos, length) || pos + length > size)
+			{
+				track.valid = false;
+				return;
+			}
+			pos += length;
+			continue;
+		}
+		if (b & 0x80)
+		{
+			status = b;
+			pos++;
+		}
+		else if (status == 0)
+		{
+			track.valid = false;
+			return;
+		}
+
+		uint8_t type = status & 0xF0;
+		size_t dataBytes = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+		if (pos + dataBytes > size)
+		{
+			track.valid = false;
+			return;
+		}
+		if (type == 0x90 || type == 0x80)
+		{
+			uint8_t pitch = data[pos] & 0x7F;
+			uint8_t velocity = data[pos + 1] & 0x7F;
+			int32_t key = (status & 0x0F) * 128 + pitch;
+			if (type == 0x90 && velocity > 0)
+			{
+				tRawNote note;
+				note.startTick = tick;
+				note.endTick = std::numeric_limits<uint64_t>::max();
+				note.pitch = pitch;
+				note.velocity = velocity;
+				int32_t index = (int32_t)track.rawNotes.size();
+				track.rawNotes.push_back(note);
+				if (openTail[key] >= 0)
+					track.rawNotes[openTail[key]].nextOpen = index;
+				else
+					openHead[key] = index;
+				openTail[key] = index;
+			}
+			else if (openHead[key] >= 0)
+			{
+				auto& note = track.rawNotes[openHead[key]];
+				note.endTick = tick;
+				openHead[key] = note.nextOpen;
+				if (openHead[key] < 0)
+					openTail[key] = -1;
+			}
+		}
+		pos += dataBytes;
+	}
+
+	// Notes that are never released end with the track
+	for (auto& note : track.rawNotes)
+	{
+		if (note.endTick == std::numeric_limits<uint64_t>::max())
+			note.endTick = tick;
+	}
+}
+
+void MidiLoader::__build_tempo_map(std::vector<tTrack>& tracks, std::vector<tTempoEvent>& outTempoMap)
+{
+	outTempoMap.clear();
+	outTempoMap.push_back(tTempoEvent());
+	for (auto& track : tracks)
+	{
+		outTempoMap.insert(outTempoMap.end(), track.tempoEvents.begin(), track.tempoEvents.end());
+		track.tempoEvents.clear();
+	}
+	std::stable_sort(outTempoMap.begin(), outTempoMap.end(), [](const tTempoEvent& a, const tTempoEvent& b) { return a.tick < b.tick; });
+	outTempoMap.front().seconds = 0.0;
+	for (size_t i = 1; i < outTempoMap.size(); i++)
+	{
+		const auto& prev = outTempoMap[i - 1];
+		outTempoMap[i].seconds = prev.seconds + (double)(outTempoMap[i].tick - prev.tick) * (double)prev.usPerQuarter / 1000000.0;
+	}
+}
+
+double MidiLoader::__tick_to_seconds(uint64_t tick, const std::vector<tTempoEvent>& tempoMap, uint16_t division)
+{
+	if (division & 0x8000)
+	{
+		// SMPTE timing: negative frames per second in the high byte, ticks per frame in the low byte
+		int32_t fps = -(int32_t)(int8_t)(division >> 8);
+		double framesPerSecond = (fps == 29 ? 29.97 : (double)fps);
+		return (double)tick / (framesPerSecond * (double)(division & 0xFF));
+	}
+	auto it = std::upper_bound(tempoMap.begin(), tempoMap.end(), tick, [](uint64_t t, const tTempoEvent& e) { return t < e.tick; });
+	const auto& tempo = *(it - 1);
+	// Segment seconds are stored in quarter-note units until divided by the PPQ here
+	return (tempo.seconds + (double)(tick - tempo.tick) * (double)tempo.usPerQuarter / 1000000.0) / (double)division;
+}
+
+void MidiLoader::__merge_tracks(std::vector<tTrack>& tracks, tResult& outResult)
+{
+	size_t total = 0;
+	for (const auto& track : tracks)
+		total += track.notes.size();
+	outResult.notes.clear();
+	outResult.notes.reserve(total);
+	if (total == 0) return;
+
+	// Ties are broken by track and position, so the output does not depend on thread timing
+	using tHeapEntry = std::tuple<float, uint32_t, uint32_t>;
+	std::priority_queue<tHeapEntry, std::vector<tHeapEntry>, std::greater<tHeapEntry>> heap;
+	for (uint32_t i = 0; i < tracks.size(); i++)
+	{
+		if (!tracks[i].notes.empty())
+			heap.emplace(tracks[i].notes[0].startTime, i, 0);
+	}
+	while (!heap.empty())
+	{
+		auto [startTime, trackIndex, noteIndex] = heap.top();
+		heap.pop();
+		auto& notes = tracks[trackIndex].notes;
+		outResult.notes.push_back(notes[noteIndex]);
+		outResult.maxNoteDuration = std::max(outResult.maxNoteDuration, (double)notes[noteIndex].duration);
+		if (++noteIndex < notes.size())
+			heap.emplace(notes[noteIndex].startTime, trackIndex, noteIndex);
+		else
+		{
+			notes.clear();
+			notes.shrink_to_fit();
+		}
+	}
+
+	auto& first = outResult.notes.front();
+	auto& last = outResult.notes.back();
+	first.flags |= PackedNote::FirstNote;
+	last.flags |= PackedNote::LastNote;
+	outResult.firstNoteStartTime = first.startTime;
+	outResult.lastNoteEndTime = last.startTime;
+}
@@ -0,0 +1,79 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostd/String.hpp>
+#include <cstdint>
+#include <vector>
+#include "NoteStore.hpp"
+
+// Standard MIDI File loader that decodes the MTrk chunks in parallel on the thread pool
+// and k-way merges the per-track note runs into a single sorted timeline.
+class MidiLoader
+{
+	public: struct tResult
+	{
+		std::vector<PackedNote> notes;
+		double firstNoteStartTime { 0.0 };
+		double lastNoteEndTime { 0.0 };
+		double maxNoteDuration { 0.0 };
+		int32_t trackCount { 0 };
+	};
+
+	private: struct tRawNote
+	{
+		uint64_t startTick { 0 };
+		uint64_t endTick { 0 };
+		int32_t nextOpen { -1 };
+		uint8_t pitch { 0 };
+		uint8_t velocity { 0 };
+	};
+	private: struct tTempoEvent
+	{
+		uint64_t tick { 0 };
+		uint32_t usPerQuarter { 500000 };
+		double seconds { 0.0 };
+	};
+	private: struct tTrack
+	{
+		const uint8_t* data { nullptr };
+		size_t size { 0 };
+		std::vector<tRawNote> rawNotes;
+		std::vector<tTempoEvent> tempoEvents;
+		std::vector<PackedNote> notes;
+		bool valid { true };
+	};
+
+	public:
+		static bool loadFile(const ostd::String& filePath, double timeOffset, tResult& outResult);
+		static bool parseBuffer(const uint8_t* data, size_t size, double timeOffset, tResult& outResult);
+		static void runLoadBenchmark(const ostd::String& directory, int32_t iterations = 10);
+
+	private:
+		static void __decode_track(tTrack& track);
+		static void __build_tempo_map(std::vector<tTrack>& tracks, std::vector<tTempoEvent>& outTempoMap);
+		static double __tick_to_seconds(uint64_t tick, const std::vector<tTempoEvent>& tempoMap, uint16_t division);
+		static void __merge_tracks(std::vector<tTrack>& tracks, tResult& outResult);
+
+	public:
+		inline static constexpr uint8_t LowestPianoKey { 21 };
+		inline static constexpr uint8_t HighestPianoKey { 108 };
+};
@@ -0,0 +1,196 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "NoteMesh.hpp"
+#include "VPianoData.hpp"
+#include "Renderer.hpp"
+#include <ostd/Logger.hpp>
+#include <ostd/Midi.hpp>
+#include <algorithm>
+
+void NoteMesh::build(const NoteStore& notes, VirtualPianoData& vpd)
+{
+	clear();
+	m_notes = &notes;
+
+	// Geometry is baked at scale 1, the vertex shader applies the current scale
+	float scaleX = (vpd.getScale().x > 0.0f ? vpd.getScale().x : 1.0f);
+	auto& offsetMap = vpd.keyOffsets();
+	for (int32_t midiNote = 21; midiNote <= 108; midiNote++)
+	{
+		auto info = ostd::MidiParser::getNoteInfo(midiNote);
+		float shrink = (info.isBlackKey() ? vpd.blackKey_shrink() : vpd.whiteKey_shrink());
+		m_keyLeftX[info.keyIndex] = (offsetMap[info.keyIndex] + (shrink / 2.0f)) / scaleX;
+	}
+	m_whiteWidth = (vpd.whiteKey_w() - vpd.whiteKey_shrink()) / scaleX;
+	m_blackWidth = (vpd.blackKey_w() - vpd.blackKey_shrink()) / scaleX;
+
+	// Notes are sorted by start time, so every page covers a contiguous slice of the list
+	size_t index = 0;
+	while (index < notes.size())
+	{
+		tPage page;
+		page.firstNote = index;
+		page.startTime = notes[index].startTime;
+		page.endTime = notes[index].endTime();
+		while (index < notes.size() && page.noteCount < MaxNotesPerPage && notes[index].startTime < page.startTime + PageDuration_s)
+		{
+			page.endTime = std::max(page.endTime, notes[index].endTime());
+			int32_t keyIndex = ostd::MidiParser::getNoteInfo(notes[index].pitch).keyIndex;
+			page.lowKey = std::min(page.lowKey, keyIndex);
+			page.highKey = std::max(page.highKey, keyIndex);
+			page.noteCount++;
+			index++;
+		}
+		m_pages.push_back(std::move(page));
+	}
+	m_pageMaxEndPrefix.resize(m_pages.size());
+	float maxEnd = 0.0f;
+	for (size_t i = 0; i < m_pages.size(); i++)
+	{
+		maxEnd = std::max(maxEnd, m_pages[i].endTime);
+		m_pageMaxEndPrefix[i] = maxEnd;
+	}
+	OX_DEBUG("Note mesh: %d notes in %d pages.", (int32_t)notes.size(), (int32_t)m_pages.size());
+}
+
+void NoteMesh::clear(void)
+{
+	m_pages.clear();
+	m_pageMaxEndPrefix.clear();
+	m_visiblePages.clear();
+	m_notes = nullptr;
+	m_residentPages = 0;
+	m_frame = 0;
+}
+
+void NoteMesh::updateVisiblePages(double currentTime, double lookAhead_s, double lookBehind_s)
+{
+	m_visiblePages.clear();
+	if (m_pages.empty()) return;
+	m_frame++;
+
+	// A note is on screen while it starts before the top edge and ends after the bottom
+	// edge. Page start times are sorted and the running maximum of end times is too,
+	// so both bounds of the candidate range are binary searches
+	double windowStart = currentTime - lookBehind_s;
+	double windowEnd = currentTime + lookAhead_s;
+	size_t first = std::distance(m_pageMaxEndPrefix.begin(), std::lower_bound(m_pageMaxEndPrefix.begin(), m_pageMaxEndPrefix.end(), (float)windowStart));
+	size_t last = std::distance(m_pages.begin(), std::upper_bound(m_pages.begin(), m_pages.end(), windowEnd, [](double time, const tPage& page) {
+		return time < page.startTime;
+	}));
+	for (size_t i = first; i < last; i++)
+	{
+		auto& page = m_pages[i];
+		if (page.endTime < windowStart) continue;
+		if (!page.resident)
+			__upload_page(page);
+		page.lastUsedFrame = m_frame;
+		m_visiblePages.push_back(i);
+	}
+	// The next page is uploaded ahead of time, so crossing a page boundary never stalls
+	if (last < m_pages.size())
+	{
+		if (!m_pages[last].resident)
+			__upload_page(m_pages[last]);
+		m_pages[last].lastUsedFrame = m_frame;
+	}
+
+	while (m_residentPages > MaxResidentPages)
+	{
+		tPage* oldest = nullptr;
+		for (auto& page : m_pages)
+		{
+			if (!page.resident || page.lastUsedFrame == m_frame) continue;
+			if (oldest == nullptr || page.lastUsedFrame < oldest->lastUsedFrame)
+				oldest = &page;
+		}
+		if (oldest == nullptr) break;
+		__release_page(*oldest);
+	}
+}
+
+void NoteMesh::draw(bool blackKeys)
+{
+	for (size_t pageIndex : m_visiblePages)
+		Renderer::drawVertexBuffer(m_pages[pageIndex].buffers[blackKeys ? 1 : 0]);
+}
+
+bool NoteMesh::getVisibleKeyRange(int32_t& outLowKey, int32_t& outHighKey) const
+{
+	// Per page rather than per note, a slightly wider range is fine for culling
+	if (m_visiblePages.empty()) return false;
+	outLowKey = 87;
+	outHighKey = 0;
+	for (size_t pageIndex : m_visiblePages)
+	{
+		outLowKey = std::min(outLowKey, m_pages[pageIndex].lowKey);
+		outHighKey = std::max(outHighKey, m_pages[pageIndex].highKey);
+	}
+	return true;
+}
+
+void NoteMesh::__upload_page(tPage& page)
+{
+	std::array<std::vector<sf::Vertex>, 2> vertices;
+	vertices[0].reserve(page.noteCount * 6);
+	vertices[1].reserve(page.noteCount * 6);
+	for (size_t i = page.firstNote; i < page.firstNote + page.noteCount; i++)
+	{
+		const auto& note = (*m_notes)[i];
+		auto info = ostd::MidiParser::getNoteInfo(note.pitch);
+		bool black = info.isBlackKey();
+		float left = m_keyLeftX[info.keyIndex];
+		float right = left + (black ? m_blackWidth : m_whiteWidth);
+		float duration = std::max(note.duration, 1e-4f);
+		// Vertex y holds the song time of the edge. Texture coordinates mark the corner
+		// and carry the duration, the colour carries the note within the octave
+		sf::Color noteId((uint8_t)info.noteInOctave, 0, 0, 255);
+		sf::Vertex topLeft { { left, note.endTime() }, noteId, { 0.0f, -duration } };
+		sf::Vertex topRight { { right, note.endTime() }, noteId, { 1.0f, -duration } };
+		sf::Vertex bottomLeft { { left, note.startTime }, noteId, { 0.0f, duration } };
+		sf::Vertex bottomRight { { right, note.startTime }, noteId, { 1.0f, duration } };
+		auto& list = vertices[black ? 1 : 0];
+		list.push_back(topLeft);
+		list.push_back(topRight);
+		list.push_back(bottomLeft);
+		list.push_back(bottomLeft);
+		list.push_back(topRight);
+		list.push_back(bottomRight);
+	}
+	for (int32_t i = 0; i < 2; i++)
+	{
+		auto& buffer = page.buffers[i];
+		buffer = sf::VertexBuffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Static);
+		if (vertices[i].empty()) continue;
+		if (!buffer.create(vertices[i].size()) || !buffer.update(vertices[i].data(), vertices[i].size(), 0))
+			OX_WARN("Unable to upload note mesh page at %.2fs.", page.startTime);
+	}
+	page.resident = true;
+	m_residentPages++;
+}
+
+void NoteMesh::__release_page(tPage& page)
+{
+	for (auto& buffer : page.buffers)
+		buffer = sf::VertexBuffer();
+	page.resident = false;
+	m_residentPages--;
+}
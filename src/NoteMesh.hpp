@@ -0,0 +1,79 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <SFML/Graphics/VertexBuffer.hpp>
+#include <array>
+#include <vector>
+#include "NoteStore.hpp"
+
+struct VirtualPianoData;
+
+// Whole-song note geometry baked into static vertex buffers in song-time coordinates
+// (see shaders/noteMesh.vert). The song is split into fixed time pages, and only
+// pages around the play head are kept on the GPU.
+class NoteMesh
+{
+	private: struct tPage
+	{
+		size_t firstNote { 0 };
+		size_t noteCount { 0 };
+		float startTime { 0.0f };
+		float endTime { 0.0f };
+		int32_t lowKey { 87 };
+		int32_t highKey { 0 };
+		std::array<sf::VertexBuffer, 2> buffers;
+		bool resident { false };
+		uint64_t lastUsedFrame { 0 };
+	};
+
+	public:
+		void build(const NoteStore& notes, VirtualPianoData& vpd);
+		void clear(void);
+		void updateVisiblePages(double currentTime, double lookAhead_s, double lookBehind_s);
+		void draw(bool blackKeys);
+		bool getVisibleKeyRange(int32_t& outLowKey, int32_t& outHighKey) const;
+
+		inline bool isBuilt(void) const { return m_notes != nullptr; }
+		inline const NoteStore* getSource(void) const { return m_notes; }
+		inline size_t getResidentPageCount(void) const { return m_residentPages; }
+
+	private:
+		void __upload_page(tPage& page);
+		void __release_page(tPage& page);
+
+	private:
+		const NoteStore* m_notes { nullptr };
+		std::vector<tPage> m_pages;
+		std::vector<float> m_pageMaxEndPrefix;
+		std::vector<size_t> m_visiblePages;
+		// Unscaled left edge of the note on each key, and note width per key colour
+		std::array<float, 88> m_keyLeftX {};
+		float m_whiteWidth { 0.0f };
+		float m_blackWidth { 0.0f };
+		size_t m_residentPages { 0 };
+		uint64_t m_frame { 0 };
+
+	public:
+		inline static constexpr float PageDuration_s { 8.0f };
+		inline static constexpr size_t MaxNotesPerPage { 32768 };
+		inline static constexpr size_t MaxResidentPages { 8 };
+};
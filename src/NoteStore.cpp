@@ -0,0 +1,235 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "NoteStore.hpp"
+#include "MidiLoader.hpp"
+#include <ostd/Logger.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+NoteStore::~NoteStore(void)
+{
+	__unmap();
+}
+
+NoteStore::NoteStore(NoteStore&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+NoteStore& NoteStore::operator=(NoteStore&& other) noexcept
+{
+	if (this == &other) return *this;
+	__unmap();
+	m_notes = std::move(other.m_notes);
+	m_data = (other.m_mapping != nullptr ? other.m_data : m_notes.data());
+	m_count = other.m_count;
+	m_mapping = other.m_mapping;
+	m_mappingSize = other.m_mappingSize;
+#ifdef _WIN32
+	m_fileHandle = other.m_fileHandle;
+	m_mappingHandle = other.m_mappingHandle;
+	other.m_fileHandle = nullptr;
+	other.m_mappingHandle = nullptr;
+#endif
+	other.m_data = nullptr;
+	other.m_count = 0;
+	other.m_mapping = nullptr;
+	other.m_mappingSize = 0;
+	return *this;
+}
+
+void NoteStore::assign(std::vector<PackedNote>&& notes)
+{
+	__unmap();
+	m_notes = std::move(notes);
+	m_data = m_notes.data();
+	m_count = m_notes.size();
+}
+
+void NoteStore::clear(void)
+{
+	__unmap();
+	m_notes.clear();
+	m_data = nullptr;
+	m_count = 0;
+}
+
+bool NoteStore::mapCacheFile(const ostd::String& filePath, uint64_t key, tCacheHeader& outHeader)
+{
+	clear();
+	void* mapping = nullptr;
+	size_t fileSize = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(tCacheHeader))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (fileMapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapping == nullptr)
+	{
+		CloseHandle(fileMapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileSize = (size_t)size.QuadPart;
+	m_fileHandle = file;
+	m_mappingHandle = fileMapping;
+#else
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(tCacheHeader))
+	{
+		close(fd);
+		return false;
+	}
+	fileSize = (size_t)st.st_size;
+	mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) return false;
+#endif
+	m_mapping = mapping;
+	m_mappingSize = fileSize;
+
+	tCacheHeader header;
+	std::memcpy(&header, m_mapping, sizeof(tCacheHeader));
+	tCacheHeader expected;
+	// The note count is checked against the file size by division, a corrupt count can
+	// not overflow into a size that happens to match
+	size_t payloadSize = fileSize - sizeof(tCacheHeader);
+	bool valid = std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) == 0 &&
+				 header.version == CacheVersion &&
+				 header.noteSize == sizeof(PackedNote) &&
+				 header.key == key &&
+				 payloadSize % sizeof(PackedNote) == 0 &&
+				 header.noteCount == payloadSize / sizeof(PackedNote);
+	if (!valid)
+	{
+		__unmap();
+		return false;
+	}
+	const PackedNote* notes = reinterpret_cast<const PackedNote*>(static_cast<const uint8_t*>(m_mapping) + sizeof(tCacheHeader));
+	size_t count = (size_t)header.noteCount;
+	// Pitches index the keyboard directly, a note outside of it would read past the keys
+	for (size_t i = 0; i < count; i++)
+	{
+		if (notes[i].pitch < MidiLoader::LowestPianoKey || notes[i].pitch > MidiLoader::HighestPianoKey)
+		{
+			OX_WARN("Note cache <%s> has a note outside of the keyboard range.", filePath.c_str());
+			__unmap();
+			return false;
+		}
+	}
+	m_data = notes;
+	m_count = count;
+	outHeader = header;
+	return true;
+}
+
+bool NoteStore::writeCacheFile(const ostd::String& filePath, const tCacheHeader& header) const
+{
+	// Write to a temporary file first, so a crash never leaves a truncated cache behind
+	ostd::String tmpPath = filePath + ".tmp";
+	std::error_code ec;
+	bool written = false;
+	{
+		std::ofstream out(tmpPath.cpp_str(), std::ios::binary | std::ios::trunc);
+		if (out)
+		{
+			tCacheHeader _header = header;
+			_header.noteCount = m_count;
+			out.write(reinterpret_cast<const char*>(&_header), sizeof(tCacheHeader));
+			if (m_count > 0)
+				out.write(reinterpret_cast<const char*>(m_data), m_count * sizeof(PackedNote));
+			out.close();
+			written = !out.fail();
+		}
+	}
+	if (written)
+		std::filesystem::rename(tmpPath.cpp_str(), filePath.cpp_str(), ec);
+	if (!written || ec)
+	{
+		std::filesystem::remove(tmpPath.cpp_str(), ec);
+		return false;
+	}
+	return true;
+}
+
+uint64_t NoteStore::hashFile(const ostd::String& filePath, uint64_t seed)
+{
+	// FNV-1a, MIDI files are small enough that this is never the bottleneck
+	std::ifstream in(filePath.cpp_str(), std::ios::binary);
+	if (!in) return 0;
+	uint64_t hash = 14695981039346656037ULL ^ seed;
+	char buffer[64 * 1024];
+	while (in)
+	{
+		in.read(buffer, sizeof(buffer));
+		std::streamsize count = in.gcount();
+		for (std::streamsize i = 0; i < count; i++)
+		{
+			hash ^= (uint8_t)buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+void NoteStore::__unmap(void)
+{
+	if (m_mapping == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_mapping);
+	if (m_mappingHandle != nullptr) CloseHandle((HANDLE)m_mappingHandle);
+	if (m_fileHandle != nullptr) CloseHandle((HANDLE)m_fileHandle);
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	munmap(m_mapping, m_mappingSize);
+#endif
+	m_mapping = nullptr;
+	m_mappingSize = 0;
+	m_data = nullptr;
+	m_count = 0;
+}
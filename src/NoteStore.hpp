@@ -0,0 +1,103 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostd/String.hpp>
+#include <cstdint>
+#include <vector>
+
+struct PackedNote
+{
+	float startTime { 0.0f };
+	float duration { 0.0f };
+	uint8_t pitch { 0 };
+	uint8_t velocity { 0 };
+	uint8_t flags { 0 };
+	uint8_t _reserved { 0 };
+	uint16_t track { 0 };
+	uint16_t _padding { 0 };
+
+	inline float endTime(void) const { return startTime + duration; }
+	inline bool isFirst(void) const { return (flags & FirstNote) != 0; }
+	inline bool isLast(void) const { return (flags & LastNote) != 0; }
+	inline bool operator<(const PackedNote& other) const { return startTime < other.startTime; }
+
+	inline static constexpr uint8_t FirstNote = 0x01;
+	inline static constexpr uint8_t LastNote = 0x02;
+};
+static_assert(sizeof(PackedNote) == 16, "PackedNote must stay 16 bytes, it is stored as-is in .klnotes files");
+
+class NoteStore
+{
+	public: struct tCacheHeader
+	{
+		char magic[8] { 'K', 'L', 'N', 'O', 'T', 'E', 'S', '\0' };
+		uint32_t version { NoteStore::CacheVersion };
+		uint32_t noteSize { sizeof(PackedNote) };
+		uint64_t key { 0 };
+		uint64_t noteCount { 0 };
+		double firstNoteStartTime { 0.0 };
+		double lastNoteEndTime { 0.0 };
+		double maxNoteDuration { 0.0 };
+		uint8_t _padding[8] { 0 };
+	};
+	static_assert(sizeof(tCacheHeader) % sizeof(PackedNote) == 0, "Notes in a .klnotes file must stay 16-byte aligned");
+
+	public:
+		inline NoteStore(void) {  }
+		~NoteStore(void);
+		NoteStore(const NoteStore&) = delete;
+		NoteStore& operator=(const NoteStore&) = delete;
+		NoteStore(NoteStore&& other) noexcept;
+		NoteStore& operator=(NoteStore&& other) noexcept;
+
+		void assign(std::vector<PackedNote>&& notes);
+		void clear(void);
+		bool mapCacheFile(const ostd::String& filePath, uint64_t key, tCacheHeader& outHeader);
+		bool writeCacheFile(const ostd::String& filePath, const tCacheHeader& header) const;
+
+		inline const PackedNote* data(void) const { return m_data; }
+		inline size_t size(void) const { return m_count; }
+		inline bool empty(void) const { return m_count == 0; }
+		inline bool isMapped(void) const { return m_mapping != nullptr; }
+		inline const PackedNote* begin(void) const { return m_data; }
+		inline const PackedNote* end(void) const { return m_data + m_count; }
+		inline const PackedNote& operator[](size_t index) const { return m_data[index]; }
+
+		static uint64_t hashFile(const ostd::String& filePath, uint64_t seed = 0);
+
+	private:
+		void __unmap(void);
+
+	private:
+		std::vector<PackedNote> m_notes;
+		const PackedNote* m_data { nullptr };
+		size_t m_count { 0 };
+		void* m_mapping { nullptr };
+		size_t m_mappingSize { 0 };
+	#ifdef _WIN32
+		void* m_fileHandle { nullptr };
+		void* m_mappingHandle { nullptr };
+	#endif
+
+	public:
+		inline static constexpr uint32_t CacheVersion { 2 };
+};
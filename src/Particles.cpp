@@ -27,6 +27,15 @@
 #include <ostd/Random.hpp>
 #include <ostd/Logger.hpp>
 #include "Common.hpp"
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
 
 
 // ============================================== TextureRef ==============================================
@@ -156,113 +165,317 @@ void PhysicsObject::physicsUpdate(void)
 
 
 
-// ============================================= Particle ==============================================
-void Particle::setup(tParticleInfo partInfo)
+// ========================================== ParticleKernel ===========================================
+void ParticleEmitter::tParticleBuffer::resize(size_t count)
 {
-	maxVelocity = 5.0f;
-	velocity = { 0, 0 };
-	acceleration = { 0, 0 };
-	velocityDamping = { 0, 0 };
+	size_t padded = ((count + SimdWidth - 1) / SimdWidth) * SimdWidth;
+	for (auto* array : { &posX, &posY, &velX, &velY, &dampX, &dampY, &life, &fullLife, &alpha, &alphaStep,
+						 &fadeInAlpha, &fadeInStep, &colorAlpha, &sizeX, &sizeY })
+		array->assign(padded, 0.0f);
+	alive.assign(padded, 0.0f);
+	age.assign(padded, 0);
+	color.assign(padded, ostd::Color());
+	texture.assign(padded, nullptr);
+	tileIndex.assign(padded, TextureRef::FullTextureCoords);
+}
 
-	float angle = partInfo.angle;
-	if (partInfo.allDirections)
-		angle = ostd::Random::getf32(0.0f, 360.0f);
-	float dirVar = angle * partInfo.randomDirection;
-	angle += ostd::Random::getf32(-dirVar, dirVar);
+void ParticleEmitter::tParticleBuffer::move(size_t from, size_t to)
+{
+	for (auto* array : { &posX, &posY, &velX, &velY, &dampX, &dampY, &life, &fullLife, &alpha, &alphaStep,
+						 &fadeInAlpha, &fadeInStep, &colorAlpha, &sizeX, &sizeY, &alive })
+		(*array)[to] = (*array)[from];
+	age[to] = age[from];
+	color[to] = color[from];
+	texture[to] = texture[from];
+	tileIndex[to] = tileIndex[from];
+	alive[from] = 0.0f;
+}
 
-	float speedVar = partInfo.speed * partInfo.randomSpeed;
-	float speed = partInfo.speed + ostd::Random::getf32(-speedVar, speedVar);
+void ParticleEmitter::updateParticlesScalar(tParticleBuffer& p, size_t begin, size_t end, const tUpdateStep& step)
+{
+	float maxVelocity2 = step.maxVelocity * step.maxVelocity;
+	for (size_t i = begin; i < end; i++)
+	{
+		if (p.alive[i] == 0.0f) continue;
+		// Alpha was stored into an 8 bit colour: truncated while fading in, rounded after
+		if (p.fadeInStep[i] > 0.0f)
+		{
+			p.fadeInAlpha[i] += p.fadeInStep[i];
+			p.colorAlpha[i] = std::trunc(p.fadeInAlpha[i]);
+			if (p.fadeInAlpha[i] >= p.alpha[i])
+			{
+				p.fadeInStep[i] = 0.0f;
+				p.colorAlpha[i] = std::trunc(p.alpha[i]);
+			}
+		}
+		else
+		{
+			p.alpha[i] -= p.alphaStep[i] * 2.0f;
+			p.life[i] -= 1.0f;
+			p.colorAlpha[i] = std::floor(p.alpha[i] + 0.5f);
+			if (p.alpha[i] <= 0.0f || p.life[i] <= 0.0f)
+			{
+				p.colorAlpha[i] = 0.0f;
+				p.alive[i] = 0.0f;
+			}
+		}
+		float vx = p.velX[i] + step.accelX;
+		float vy = p.velY[i] + step.accelY;
+		float length2 = (vx * vx) + (vy * vy);
+		if (length2 > maxVelocity2)
+		{
+			float scale = step.maxVelocity / std::sqrt(length2);
+			vx *= scale;
+			vy *= scale;
+		}
+		p.posX[i] += vx;
+		p.posY[i] += vy;
+		p.velX[i] = vx * p.dampX[i];
+		p.velY[i] = vy * p.dampY[i];
+	}
+}
 
-	float rad = DEG_TO_RAD(angle);
-	velocity = { speed * std::cos(rad), -speed * std::sin(rad) };
-	ostd::Vec2 velVar { velocity.x * partInfo.randomVelocity.x, velocity.y * partInfo.randomVelocity.y };
-	velocity.x += ostd::Random::getf32(-velVar.x, velVar.x);
-	velocity.y += ostd::Random::getf32(-velVar.y, velVar.y);
+#if defined(__x86_64__) || defined(__i386__)
+// Same steps as updateParticlesScalar, on every lane at once. Both branches of the fade
+// are computed and the lane masks pick the result; dead lanes keep their values
+#define PARTICLE_KERNEL_BODY(VEC, LOAD, STORE, SET1, ADD, SUB, MUL, DIV, SQRT, AND, ANDNOT, OR, CMPGT, CMPGE, CMPLE, SELECT, TRUNC, FLOOR, WIDTH) \
+	const VEC zero = SET1(0.0f); \
+	const VEC one = SET1(1.0f); \
+	const VEC two = SET1(2.0f); \
+	const VEC half = SET1(0.5f); \
+	const VEC accelX = SET1(step.accelX); \
+	const VEC accelY = SET1(step.accelY); \
+	const VEC maxVelocity = SET1(step.maxVelocity); \
+	const VEC maxVelocity2 = SET1(step.maxVelocity * step.maxVelocity); \
+	for (size_t i = 0; i < count; i += WIDTH) \
+	{ \
+		VEC alive = LOAD(&p.alive[i]); \
+		VEC live = CMPGT(alive, zero); \
+		VEC fadeStep = LOAD(&p.fadeInStep[i]); \
+		VEC fadeAlpha = LOAD(&p.fadeInAlpha[i]); \
+		VEC alpha = LOAD(&p.alpha[i]); \
+		VEC life = LOAD(&p.life[i]); \
+		VEC inFade = AND(CMPGT(fadeStep, zero), live); \
+		VEC fading = ANDNOT(inFade, live); \
+		\
+		VEC fadeAlphaNext = ADD(fadeAlpha, fadeStep); \
+		VEC fadeDone = AND(CMPGE(fadeAlphaNext, alpha), inFade); \
+		VEC fadeColor = SELECT(fadeDone, TRUNC(alpha), TRUNC(fadeAlphaNext)); \
+		\
+		VEC alphaNext = SUB(alpha, MUL(LOAD(&p.alphaStep[i]), two)); \
+		VEC lifeNext = SUB(life, one); \
+		VEC killed = AND(OR(CMPLE(alphaNext, zero), CMPLE(lifeNext, zero)), fading); \
+		VEC fadingColor = ANDNOT(killed, FLOOR(ADD(alphaNext, half))); \
+		\
+		STORE(&p.fadeInAlpha[i], SELECT(inFade, fadeAlphaNext, fadeAlpha)); \
+		STORE(&p.fadeInStep[i], ANDNOT(fadeDone, fadeStep)); \
+		STORE(&p.alpha[i], SELECT(fading, alphaNext, alpha)); \
+		STORE(&p.life[i], SELECT(fading, lifeNext, life)); \
+		STORE(&p.colorAlpha[i], SELECT(inFade, fadeColor, SELECT(fading, fadingColor, LOAD(&p.colorAlpha[i])))); \
+		STORE(&p.alive[i], ANDNOT(killed, alive)); \
+		\
+		VEC vx = ADD(LOAD(&p.velX[i]), accelX); \
+		VEC vy = ADD(LOAD(&p.velY[i]), accelY); \
+		VEC length2 = ADD(MUL(vx, vx), MUL(vy, vy)); \
+		VEC scale = SELECT(CMPGT(length2, maxVelocity2), DIV(maxVelocity, SQRT(length2)), one); \
+		vx = MUL(vx, scale); \
+		vy = MUL(vy, scale); \
+		VEC px = LOAD(&p.posX[i]); \
+		VEC py = LOAD(&p.posY[i]); \
+		STORE(&p.posX[i], SELECT(live, ADD(px, vx), px)); \
+		STORE(&p.posY[i], SELECT(live, ADD(py, vy), py)); \
+		STORE(&p.velX[i], SELECT(live, MUL(vx, LOAD(&p.dampX[i])), LOAD(&p.velX[i]))); \
+		STORE(&p.velY[i], SELECT(live, MUL(vy, LOAD(&p.dampY[i])), LOAD(&p.velY[i]))); \
+	}
 
-	float lifeVar = partInfo.lifeSpan * partInfo.randomLifeSpan;
-	life = partInfo.lifeSpan;
-	life += ostd::Random::getf32(-lifeVar, lifeVar);
+// SSE2 is part of every x86-64 CPU. Values truncated here are never negative, so the
+// integer conversion stands in for the SSE4.1 rounding instructions
+#define SSE_SELECT(mask, a, b) _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#define SSE_TRUNC(a) _mm_cvtepi32_ps(_mm_cvttps_epi32(a))
+static void __update_particles_sse(ParticleEmitter::tParticleBuffer& p, size_t count, const ParticleEmitter::tUpdateStep& step)
+{
+	PARTICLE_KERNEL_BODY(__m128, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps, _mm_sqrt_ps,
+						 _mm_and_ps, _mm_andnot_ps, _mm_or_ps, _mm_cmpgt_ps, _mm_cmpge_ps, _mm_cmple_ps, SSE_SELECT, SSE_TRUNC, SSE_TRUNC, 4)
+}
 
-	color = partInfo.color;
-	float alphaVar = color.a * partInfo.randomAlpha;
-	color.a += ostd::Random::geti8(-(int8_t)alphaVar, (int8_t)alphaVar);
-	alpha = 0.0f;
-	m_curr_alpha = 0.0f;
+#define AVX_CMPGT(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define AVX_CMPGE(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define AVX_CMPLE(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define AVX_SELECT(mask, a, b) _mm256_blendv_ps(b, a, mask)
+#define AVX_TRUNC(a) _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+__attribute__((target("avx2")))
+static void __update_particles_avx2(ParticleEmitter::tParticleBuffer& p, size_t count, const ParticleEmitter::tUpdateStep& step)
+{
+	PARTICLE_KERNEL_BODY(__m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_sqrt_ps,
+						 _mm256_and_ps, _mm256_andnot_ps, _mm256_or_ps, AVX_CMPGT, AVX_CMPGE, AVX_CMPLE, AVX_SELECT, AVX_TRUNC, _mm256_floor_ps, 8)
+}
+#endif
 
-	size = partInfo.size;
-	ostd::Vec2 sizeVar { size.x * partInfo.randomSize.x, size.y * partInfo.randomSize.y };
-	size.x += ostd::Random::getf32(-sizeVar.x, sizeVar.x);
-	size.y += ostd::Random::getf32(-sizeVar.y, sizeVar.y);
+void ParticleEmitter::updateParticles(tParticleBuffer& particles, size_t count, const tUpdateStep& step)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	static const bool s_hasAVX2 = __builtin_cpu_supports("avx2");
+	if (s_hasAVX2)
+		__update_particles_avx2(particles, count, step);
+	else
+		__update_particles_sse(particles, count, step);
+#else
+	updateParticlesScalar(particles, 0, count, step);
+#endif
+}
 
-	if (partInfo.randomDamping)
+void ParticleEmitter::runUpdateBenchmark(int32_t emitterCount, int32_t particleCount, int32_t iterations)
+{
+	emitterCount = std::max(emitterCount, 1);
+	particleCount = std::max(particleCount, 1);
+	iterations = std::max(iterations, 1);
+
+	// Random particles that live past the end of the run, so both kernels see the same
+	// live count on every frame. A quarter of them are still fading in
+	std::vector<tParticleBuffer> scalar(emitterCount);
+	tParticleRandom random;
+	random.seed(1);
+	for (auto& p : scalar)
 	{
-		velocityDamping.x += ostd::Random::getf32(0, partInfo.damping.x);
-		velocityDamping.y += ostd::Random::getf32(0, partInfo.damping.y);
+		p.resize(particleCount);
+		for (int32_t i = 0; i < particleCount; i++)
+		{
+			p.posX[i] = random.getf32(0.0f, 1920.0f);
+			p.posY[i] = random.getf32(0.0f, 1080.0f);
+			p.velX[i] = random.getf32(-3.0f, 3.0f);
+			p.velY[i] = random.getf32(-3.0f, 3.0f);
+			p.dampX[i] = random.getf32(0.9f, 1.0f);
+			p.dampY[i] = random.getf32(0.9f, 1.0f);
+			p.life[i] = random.getf32((float)iterations + 10.0f, (float)iterations * 2.0f + 10.0f);
+			p.fullLife[i] = p.life[i];
+			p.alpha[i] = random.getf32(200.0f, 255.0f);
+			p.alphaStep[i] = p.alpha[i] / (p.life[i] * 4.0f);
+			p.fadeInStep[i] = (i % 4 == 0 ? random.getf32(1.0f, 5.0f) : 0.0f);
+			p.colorAlpha[i] = (p.fadeInStep[i] > 0.0f ? 0.0f : p.alpha[i]);
+			p.alive[i] = 1.0f;
+		}
 	}
-
-	texture = partInfo.texture;
-	tileIndex = partInfo.tileIndex;
-
-	m_ready = true;
-	m_dead = false;
-
-	m_fade_in = true;
-	fadeIn = partInfo.fadeIn;
-	if (fadeIn)
+	std::vector<tParticleBuffer> vector = scalar;
+	tUpdateStep step;
+	step.accelX = 0.01f;
+	step.accelY = -0.03f;
+	step.maxVelocity = MaxParticleVelocity;
+	size_t kernelCount = ((size_t)particleCount + SimdWidth - 1) / SimdWidth * SimdWidth;
+
+	auto l_measure = [iterations](const std::function<void(void)>& func, double& outMin, double& outMean) {
+		outMin = std::numeric_limits<double>::max();
+		outMean = 0.0;
+		for (int32_t i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			outMin = std::min(outMin, elapsed);
+			outMean += elapsed / iterations;
+		}
+	};
+	double scalarMin = 0.0, scalarMean = 0.0, vectorMin = 0.0, vectorMean = 0.0;
+	l_measure([&]() {
+		for (auto& p : scalar)
+			updateParticlesScalar(p, 0, (size_t)particleCount, step);
+	}, scalarMin, scalarMean);
+	l_measure([&]() {
+		for (auto& p : vector)
+			updateParticles(p, kernelCount, step);
+	}, vectorMin, vectorMean);
+
+	// Both kernels ran the same frames on the same data and have to agree
+	float maxDiff = 0.0f;
+	int32_t aliveMismatch = 0;
+	for (int32_t e = 0; e < emitterCount; e++)
 	{
-		alpha = color.a;
-		m_alpha_dec = color.a / life;
-		color.a = 0;
-		life /= 2.0f;
+		for (int32_t i = 0; i < particleCount; i++)
+		{
+			const auto& a = scalar[e];
+			const auto& b = vector[e];
+			for (float diff : { a.posX[i] - b.posX[i], a.posY[i] - b.posY[i], a.velX[i] - b.velX[i], a.velY[i] - b.velY[i],
+								a.alpha[i] - b.alpha[i], a.life[i] - b.life[i], a.colorAlpha[i] - b.colorAlpha[i] })
+				maxDiff = std::max(maxDiff, std::abs(diff));
+			if (a.alive[i] != b.alive[i])
+				aliveMismatch++;
+		}
 	}
+
+	const char* kernelName = "scalar";
+#if defined(__x86_64__) || defined(__i386__)
+	kernelName = (__builtin_cpu_supports("avx2") ? "AVX2" : "SSE2");
+#endif
+	OX_DEBUG("Particle update benchmark: %d emitters x %d particles, %d frames.", emitterCount, particleCount, iterations);
+	OX_DEBUG("  Scalar: min %.3f ms avg %.3f ms per frame", scalarMin, scalarMean);
+	OX_DEBUG("  %s: min %.3f ms avg %.3f ms per frame (%.2fx)", kernelName, vectorMin, vectorMean, scalarMean / std::max(vectorMean, 1e-9));
+	if (maxDiff > 1e-3f || aliveMismatch > 0)
+		OX_WARN("  Kernels disagree: max difference %f, %d alive flags differ.", maxDiff, aliveMismatch);
 	else
-	{
-		m_alpha_dec = color.a / life;
-		alpha = color.a;
-	}
+		OX_DEBUG("  Results match (max difference %f).", maxDiff);
+}
+// =====================================================================================================
+
+
+
+
 
-	fullLife = life;
-	fulLAlpha = color.a;
-	m_fade_in_mult = (partInfo.lifeSpan / 100.0f);
-	colorRamp = partInfo.colorRamp;
 
-	// velocity *= Common::deltaTime;
-}
 
-void Particle::beforeUpdate(void)
+// =========================================== ColorLUT ================================================
+static bool __same_ramp(const std::vector<tColorInterpolator>& a, const std::vector<tColorInterpolator>& b)
 {
-	if (isDead()) return;
-	if (colorRamp.count() > 0)
+	if (a.size() != b.size()) return false;
+	auto sameColor = [](const ostd::Color& c1, const ostd::Color& c2) {
+		return c1.r == c2.r && c1.g == c2.g && c1.b == c2.b && c1.a == c2.a;
+	};
+	for (size_t i = 0; i < a.size(); i++)
 	{
-		color.r = colorRamp.current().r;
-		color.g = colorRamp.current().g;
-		color.b = colorRamp.current().b;
-		colorRamp.update();
+		if (!sameColor(a[i].start, b[i].start) || !sameColor(a[i].end, b[i].end) || a[i].length != b[i].length || a[i].percent != b[i].percent)
+			return false;
 	}
-	if (m_fade_in && fadeIn)
+	return true;
+}
+
+static std::shared_ptr<const tColorLUT> __bake_color_lut(const ColorRamp& ramp)
+{
+	// Every particle used to step its own copy of the ramp once per frame, so the colour
+	// only depends on the particle's age. The frames are stepped once and resampled
+	std::vector<ostd::Color> frames;
+	ColorRamp copy = ramp;
+	for (size_t n = 0; n < ParticleEmitter::MaxRampFrames && !copy.done; n++)
 	{
-		m_curr_alpha += (m_alpha_dec * m_fade_in_mult);
-		color.a = m_curr_alpha;
-		if (m_curr_alpha >= alpha)
-		{
-			m_fade_in = false;
-			color.a = alpha;
-		}
-		return;
+		frames.push_back(copy.current());
+		copy.update();
 	}
-	alpha -= m_alpha_dec * 2.0f;
-	life--;
-	if (alpha <= 0 || life <= 0)
+	frames.push_back(copy.current());
+	auto lut = std::make_shared<tColorLUT>();
+	float lastFrame = (float)(frames.size() - 1);
+	for (size_t k = 0; k < tColorLUT::Size; k++)
 	{
-		color.a = 0;
-		kill();
+		size_t frame = (size_t)std::round(lastFrame * (float)k / (float)(tColorLUT::Size - 1));
+		lut->colors[k] = frames[frame];
 	}
-	else color.a = std::round(alpha);
+	lut->ageScale = (lastFrame > 0.0f ? (float)(tColorLUT::Size - 1) / lastFrame : 0.0f);
+	return lut;
 }
 
-void Particle::kill(void)
+// Emitters created from the same style share one table
+static std::shared_ptr<const tColorLUT> __get_shared_color_lut(const ColorRamp& ramp)
 {
-	 m_dead = true;
+	static std::mutex s_mutex;
+	static std::vector<std::pair<std::vector<tColorInterpolator>, std::weak_ptr<const tColorLUT>>> s_luts;
+	if (ramp.m_colors.size() == 0) return nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::erase_if(s_luts, [](const auto& entry) { return entry.second.expired(); });
+	for (const auto& [source, lut] : s_luts)
+	{
+		if (!__same_ramp(source, ramp.m_colors)) continue;
+		if (auto shared = lut.lock())
+			return shared;
+	}
+	auto lut = __bake_color_lut(ramp);
+	s_luts.push_back({ ramp.m_colors, lut });
+	return lut;
 }
 // =====================================================================================================
 
@@ -292,12 +505,12 @@ ParticleEmitter& ParticleEmitter::create(ostd::Rectangle emissionRect, uint32_t
 {
 	setEmissionRect(emissionRect);
 	m_particles.resize(maxParticles);
-	for (auto& part : m_particles)
-		part.kill();
 	m_particleCount = maxParticles;
+	m_liveCount = 0;
 	m_currentPathValue = 0.0f;
+	setRandomSeed((uint64_t)ostd::Random::geti32(0, INT32_MAX));
 
-	m_vertexArray.resize(maxParticles * 6); // 6 because it is for two triangles per particles
+	m_vertexArray.clear();
 	m_vertexArray.setPrimitiveType(sf::PrimitiveType::Triangles);
 
 	enablePath(false);
@@ -308,9 +521,18 @@ ParticleEmitter& ParticleEmitter::create(ostd::Rectangle emissionRect, uint32_t
 }
 
 void ParticleEmitter::update(const ostd::Vec2& force)
+{
+	__step(force, true);
+}
+
+void ParticleEmitter::simulate(const ostd::Vec2& force)
+{
+	__step(force, false);
+}
+
+void ParticleEmitter::__step(const ostd::Vec2& force, bool writeVertices)
 {
 	if (isInvalid()) return;
-	sf::VertexArray a;
 	if (m_path.isEnabled() && m_path.exists())
 	{
 		m_currentPathValue += m_pathStep;
@@ -320,92 +542,144 @@ void ParticleEmitter::update(const ostd::Vec2& force)
 		m_currentPathPoint = m_path.getPoint(fOffset);
 		setEmissionRect({ m_currentPathPoint.position, 10.0f, 10.0f });
 	}
-	int32_t activeParticleCount = 0;
-	m_vertexArray.clear();
-	for (uint32_t i = 0, k = 0; i < m_particleCount; i++)
+	if (isSleeping())
+	{
+		if (m_vertexArray.getVertexCount() > 0)
+			m_vertexArray.clear();
+		return;
+	}
+	auto& p = m_particles;
+	uint32_t liveLimit = getLiveParticleLimit();
+	if (m_liveCount > liveLimit)
+		__thin_particles((uint32_t)std::ceil((float)(m_liveCount - liveLimit) * ThinRate));
+	bool useTiles = writeVertices && m_useTileArray && m_tileArray.size() > 0;
+	bool useWorkingRect = m_workingRect.w != 0 && m_workingRect.h != 0;
+	if (useTiles || useWorkingRect)
 	{
-		auto& part = m_particles[i];
-		if (part.isDead()) continue;
-		if (m_useTileArray && m_tileArray.size() > 0)
+		for (size_t i = 0; i < m_liveCount; i++)
 		{
-			float tile = (float)m_tileArray.size() / part.fullLife;
-			tile *= part.life;
-			uint32_t i = m_tileArray.size() - (uint32_t)std::round(tile);
-			if (i < 0) i = 0;
-			else if (i >= m_tileArray.size()) i = m_tileArray.size() - 1;
-			part.tileIndex = m_tileArray[i];
+			if (useTiles)
+			{
+				size_t t = (size_t)(p.life[i] / p.fullLife[i] * (float)(TileLUTSize - 1) + 0.5f);
+				p.tileIndex[i] = m_tileLUT[std::min(t, TileLUTSize - 1)];
+			}
+			if (useWorkingRect)
+			{
+				if (p.posX[i] + p.sizeX[i] < m_workingRect.x ||
+					p.posY[i] + p.sizeY[i] < m_workingRect.y ||
+					p.posX[i] > m_workingRect.x + m_workingRect.w ||
+					p.posY[i] > m_workingRect.y + m_workingRect.h)
+				{
+					p.alive[i] = 0.0f;
+				}
+			}
 		}
-		if (m_workingRect.w != 0 && m_workingRect.h != 0)
+	}
+
+	// The force is the same for every particle, so it is scaled and limited once here
+	// instead of going through PhysicsObject::applyForce per particle
+	ostd::Vec2 accel = force;
+	accel *= Common::deltaTime;
+	accel.limit(2.0f * Common::deltaTime);
+	tUpdateStep step;
+	step.accelX = accel.x;
+	step.accelY = accel.y;
+	step.maxVelocity = MaxParticleVelocity;
+	// Slots past the live count are dead, so the kernel can run up to the next full vector
+	size_t kernelCount = ((m_liveCount + SimdWidth - 1) / SimdWidth) * SimdWidth;
+	updateParticles(p, kernelCount, step);
+
+	// Dead particles are swap-removed with the last live one while the vertices are written,
+	// which keeps the live range packed for the next emit and update.
+	// Particles that faded out this frame would only have been drawn fully transparent, so they are skipped
+	if (!writeVertices)
+	{
+		m_vertexArray.clear();
+		size_t i = 0;
+		while (i < m_liveCount)
 		{
-			if (part.position.x + part.size.x < m_workingRect.x ||
-				part.position.y + part.size.y < m_workingRect.y ||
-				part.position.x > m_workingRect.x + m_workingRect.w ||
-				part.position.y > m_workingRect.y + m_workingRect.h)
+			if (p.alive[i] == 0.0f)
 			{
-				part.kill();
+				m_liveCount--;
+				if (i != m_liveCount)
+					p.move(m_liveCount, i);
 				continue;
 			}
+			p.age[i]++;
+			i++;
+		}
+		return;
+	}
+	m_vertexArray.resize(m_liveCount * 6);
+	size_t i = 0;
+	while (i < m_liveCount)
+	{
+		if (p.alive[i] == 0.0f)
+		{
+			m_liveCount--;
+			if (i != m_liveCount)
+				p.move(m_liveCount, i);
+			continue;
 		}
-		activeParticleCount++;
-		part.applyForce(force);
-		part.physicsUpdate();
-
-		size_t v = k * 6;
-
-        for (int j = 0; j < 6; ++j)
-        {
-        	m_vertexArray.append(sf::Vertex());
-        	m_vertexArray[v + j].color = sf_color(part.color);
-        }
-
-        m_vertexArray[v + 0].position = { part.position.x, part.position.y };
-        m_vertexArray[v + 1].position = { part.position.x + part.size.x, part.position.y };
-        m_vertexArray[v + 2].position = { part.position.x, part.position.y + part.size.y };
-        m_vertexArray[v + 3].position = { part.position.x + part.size.x, part.position.y };
-        m_vertexArray[v + 4].position = { part.position.x + part.size.x, part.position.y + part.size.y };
-        m_vertexArray[v + 5].position = { part.position.x, part.position.y + part.size.y };
-
-        TextureRef::tTexCoords uv;
-       	if (part.texture != nullptr)
-        	uv = part.texture->getTile(part.tileIndex);
-
-        m_vertexArray[v + 0].texCoords = { uv.topLeft.x,     uv.topLeft.y     };     // TL
-        m_vertexArray[v + 1].texCoords = { uv.topRight.x,    uv.topRight.y    };    // TR
-        m_vertexArray[v + 2].texCoords = { uv.bottomLeft.x,  uv.bottomLeft.y  };  // BL
-        m_vertexArray[v + 3].texCoords = { uv.topRight.x,    uv.topRight.y    };    // TR
-        m_vertexArray[v + 4].texCoords = { uv.bottomRight.x, uv.bottomRight.y }; // BR
-        m_vertexArray[v + 5].texCoords = { uv.bottomLeft.x,  uv.bottomLeft.y  };  // BL
-
-        k++;
+		if (m_colorLUT != nullptr)
+		{
+			const auto& rampColor = m_colorLUT->sample(p.age[i]);
+			p.color[i].r = rampColor.r;
+			p.color[i].g = rampColor.g;
+			p.color[i].b = rampColor.b;
+		}
+		p.age[i]++;
+		p.color[i].a = (uint8_t)std::clamp(p.colorAlpha[i], 0.0f, 255.0f);
+
+		float x = p.posX[i], y = p.posY[i];
+		float w = p.sizeX[i], h = p.sizeY[i];
+		size_t v = i * 6;
+		auto color = sf_color(p.color[i]);
+		for (int j = 0; j < 6; ++j)
+			m_vertexArray[v + j].color = color;
+
+		m_vertexArray[v + 0].position = { x,     y     };
+		m_vertexArray[v + 1].position = { x + w, y     };
+		m_vertexArray[v + 2].position = { x,     y + h };
+		m_vertexArray[v + 3].position = { x + w, y     };
+		m_vertexArray[v + 4].position = { x + w, y + h };
+		m_vertexArray[v + 5].position = { x,     y + h };
+
+		TextureRef::tTexCoords uv;
+		if (p.texture[i] != nullptr)
+			uv = p.texture[i]->getTile(p.tileIndex[i]);
+
+		m_vertexArray[v + 0].texCoords = { uv.topLeft.x,     uv.topLeft.y     };     // TL
+		m_vertexArray[v + 1].texCoords = { uv.topRight.x,    uv.topRight.y    };    // TR
+		m_vertexArray[v + 2].texCoords = { uv.bottomLeft.x,  uv.bottomLeft.y  };  // BL
+		m_vertexArray[v + 3].texCoords = { uv.topRight.x,    uv.topRight.y    };    // TR
+		m_vertexArray[v + 4].texCoords = { uv.bottomRight.x, uv.bottomRight.y }; // BR
+		m_vertexArray[v + 5].texCoords = { uv.bottomLeft.x,  uv.bottomLeft.y  };  // BL
+
+		i++;
 	}
+	m_vertexArray.resize(m_liveCount * 6);
 }
 
 void ParticleEmitter::reset(void)
 {
 	if (!isValid()) return;
-	for (auto& part : m_particles)
-		part.kill();
+	std::fill(m_particles.alive.begin(), m_particles.alive.begin() + m_liveCount, 0.0f);
+	m_liveCount = 0;
+	m_random.seed(m_randomSeed);
 	m_currentPathValue = 0.0f;
 	enablePath(false);
 }
 
-void ParticleEmitter::emit(tParticleInfo partInfo, int32_t count)
+void ParticleEmitter::emit(const tParticleInfo& partInfo, int32_t count)
 {
 	if (isInvalid()) return;
 	if (count <= 0) return;
-	uint32_t index = 0;
-	// partInfo.angle = 90;
-	for (auto& part : m_particles)
-	{
-		if (part.isDead())
-		{
-			part.position = getEmissionRect().getPosition() + getRandomEmissionPoint();
-			part.setup(partInfo);
-			count--;
-			if (count <= 0) return;
-		}
-		index++;
-	}
+	__update_color_lut(partInfo.colorRamp);
+	// Live particles are packed, so new ones always go right after the last live slot
+	uint32_t liveLimit = getLiveParticleLimit();
+	for (; count > 0 && m_liveCount < liveLimit; count--)
+		__setup_particle(m_liveCount++, partInfo, getEmissionRect().getPosition() + getRandomEmissionPoint());
 }
 
 void ParticleEmitter::emit(int32_t count)
@@ -423,11 +697,165 @@ void ParticleEmitter::addTilesToArray(const std::vector<TextureRef::TextureAtlas
 {
 	for (const auto& tile : array)
 		m_tileArray.push_back(tile);
+	// Same mapping the tiles used when computed per particle: the tile advances as the
+	// remaining life drops, entry k stands for life / fullLife == k / (TileLUTSize - 1)
+	int32_t tileCount = (int32_t)m_tileArray.size();
+	m_tileLUT.resize(TileLUTSize);
+	for (size_t k = 0; k < TileLUTSize; k++)
+	{
+		float lifeRatio = (float)k / (float)(TileLUTSize - 1);
+		int32_t t = tileCount - (int32_t)std::round((float)tileCount * lifeRatio);
+		m_tileLUT[k] = m_tileArray[std::clamp(t, 0, tileCount - 1)];
+	}
 }
 
 ostd::Vec2 ParticleEmitter::getRandomEmissionPoint(void)
 {
-	return ostd::Random::getVec2({ 0, getEmissionRect().w }, { 0, getEmissionRect().h });
+	return m_random.getVec2({ 0, getEmissionRect().w }, { 0, getEmissionRect().h });
+}
+
+void ParticleEmitter::__thin_particles(uint32_t count)
+{
+	// Picks the particles with the least life left, relative to their full life. They are
+	// also the faintest, since the alpha fades along with the life
+	auto& p = m_particles;
+	count = std::min(count, m_liveCount);
+	if (count == 0) return;
+	m_thinScratch.resize(m_liveCount);
+	for (uint32_t i = 0; i < m_liveCount; i++)
+		m_thinScratch[i] = i;
+	auto lifeLeft = [&p](uint32_t a, uint32_t b) {
+		return p.life[a] * p.fullLife[b] < p.life[b] * p.fullLife[a];
+	};
+	if (count < m_liveCount)
+		std::nth_element(m_thinScratch.begin(), m_thinScratch.begin() + count, m_thinScratch.end(), lifeLeft);
+	for (uint32_t i = 0; i < count; i++)
+		p.alive[m_thinScratch[i]] = 0.0f;
+}
+
+std::shared_ptr<const tColorLUT> ParticleEmitter::getColorLUT(void)
+{
+	__update_color_lut(m_defaultParticle.colorRamp);
+	return m_colorLUT;
+}
+
+void ParticleEmitter::__setup_particle(size_t index, const tParticleInfo& partInfo, const ostd::Vec2& position)
+{
+	auto& p = m_particles;
+	float angle = partInfo.angle;
+	if (partInfo.allDirections)
+		angle = m_random.getf32(0.0f, 360.0f);
+	float dirVar = angle * partInfo.randomDirection;
+	angle += m_random.getf32(-dirVar, dirVar);
+
+	float speedVar = partInfo.speed * partInfo.randomSpeed;
+	float speed = partInfo.speed + m_random.getf32(-speedVar, speedVar);
+
+	float rad = DEG_TO_RAD(angle);
+	ostd::Vec2 velocity { speed * std::cos(rad), -speed * std::sin(rad) };
+	ostd::Vec2 velVar { velocity.x * partInfo.randomVelocity.x, velocity.y * partInfo.randomVelocity.y };
+	velocity.x += m_random.getf32(-velVar.x, velVar.x);
+	velocity.y += m_random.getf32(-velVar.y, velVar.y);
+
+	float lifeVar = partInfo.lifeSpan * partInfo.randomLifeSpan;
+	float life = partInfo.lifeSpan;
+	life += m_random.getf32(-lifeVar, lifeVar);
+
+	ostd::Color color = partInfo.color;
+	float alphaVar = color.a * partInfo.randomAlpha;
+	color.a += (int8_t)m_random.geti32(-(int8_t)alphaVar, (int8_t)alphaVar);
+
+	ostd::Vec2 size = partInfo.size;
+	ostd::Vec2 sizeVar { size.x * partInfo.randomSize.x, size.y * partInfo.randomSize.y };
+	size.x += m_random.getf32(-sizeVar.x, sizeVar.x);
+	size.y += m_random.getf32(-sizeVar.y, sizeVar.y);
+
+	ostd::Vec2 damping { 0.0f, 0.0f };
+	if (partInfo.randomDamping)
+	{
+		damping.x += m_random.getf32(0, partInfo.damping.x);
+		damping.y += m_random.getf32(0, partInfo.damping.y);
+	}
+
+	float alpha = color.a;
+	p.alphaStep[index] = alpha / life;
+	p.alpha[index] = alpha;
+	p.fadeInAlpha[index] = 0.0f;
+	if (partInfo.fadeIn)
+	{
+		p.fadeInStep[index] = p.alphaStep[index] * (partInfo.lifeSpan / 100.0f);
+		p.colorAlpha[index] = 0.0f;
+		life /= 2.0f;
+	}
+	else
+	{
+		p.fadeInStep[index] = 0.0f;
+		p.colorAlpha[index] = alpha;
+	}
+
+	p.posX[index] = position.x;
+	p.posY[index] = position.y;
+	p.velX[index] = velocity.x;
+	p.velY[index] = velocity.y;
+	p.dampX[index] = 1.0f - std::min(damping.x, 0.9999f);
+	p.dampY[index] = 1.0f - std::min(damping.y, 0.9999f);
+	p.life[index] = life;
+	p.fullLife[index] = life;
+	p.sizeX[index] = size.x;
+	p.sizeY[index] = size.y;
+	p.color[index] = color;
+	p.texture[index] = partInfo.texture;
+	p.tileIndex[index] = partInfo.tileIndex;
+	p.age[index] = 0;
+	p.alive[index] = 1.0f;
+}
+
+void ParticleEmitter::__update_color_lut(const ColorRamp& ramp)
+{
+	const auto& colors = ramp.m_colors;
+	if (__same_ramp(colors, m_rampSource)) return;
+	m_rampSource = colors;
+	m_colorLUT = __get_shared_color_lut(ramp);
+}
+// =====================================================================================================
+
+
+
+
+
+
+
+// =========================================== ParticleBatch ===========================================
+void ParticleBatch::clear(void)
+{
+	m_vertices.clear();
+	m_vertexCount = 0;
+}
+
+void ParticleBatch::add(ParticleEmitter& emitter)
+{
+	auto& vertices = emitter.getVertexArray();
+	size_t count = vertices.getVertexCount();
+	if (count == 0) return;
+	m_vertices.insert(m_vertices.end(), &vertices[0], &vertices[0] + count);
+}
+
+void ParticleBatch::upload(void)
+{
+	m_vertexCount = m_vertices.size();
+	m_useVertexBuffer = false;
+	if (m_vertexCount == 0 || !sf::VertexBuffer::isAvailable()) return;
+	// Grows with headroom so steady particle counts never reallocate the buffer
+	if (m_vertexBuffer.getVertexCount() < m_vertexCount)
+	{
+		size_t capacity = std::max(m_vertexCount + m_vertexCount / 2, m_vertexBuffer.getVertexCount() * 2);
+		if (!m_vertexBuffer.create(capacity))
+		{
+			OX_WARN("Unable to allocate the particle vertex buffer (%d vertices).", (int32_t)capacity);
+			return;
+		}
+	}
+	m_useVertexBuffer = m_vertexBuffer.update(m_vertices.data(), m_vertexCount, 0);
 }
 // =====================================================================================================
 
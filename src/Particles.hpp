@@ -21,13 +21,17 @@
 #pragma once
 
 #include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
 #include <ostd/BaseObject.hpp>
 #include <ostd/Color.hpp>
 #include <ostd/Defines.hpp>
 #include <ostd/Spline.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include <array>
+#include <memory>
 #include <any>
+#include <cmath>
 
 class TextureRef : public ostd::BaseObject
 {
@@ -202,6 +206,38 @@ class ColorRamp
 		bool done { false };
 };
 
+// Small splitmix64 generator. Each emitter owns one, so emitters can be simulated on any
+// thread in any order and still produce the same particles for the same seed
+struct tParticleRandom
+{
+	uint64_t state { 0 };
+
+	inline void seed(uint64_t s) { state = s; }
+	inline uint64_t next(void)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+	inline float getf32(float min = 0.0f, float max = 1.0f) { return min + (max - min) * ((float)(next() >> 40) * (1.0f / 16777216.0f)); }
+	inline int32_t geti32(int32_t min, int32_t max) { if (max <= min) return min; return min + (int32_t)(next() % (uint64_t)((int64_t)max - min + 1)); }
+	inline ostd::Vec2 getVec2(ostd::Vec2 xRange, ostd::Vec2 yRange) { float x = getf32(xRange.x, xRange.y); return { x, getf32(yRange.x, yRange.y) }; }
+};
+
+// A ColorRamp baked into a fixed number of entries. The ramp runs for a fixed number of
+// frames, so entries are indexed by particle age normalized to that duration
+struct tColorLUT
+{
+	inline static constexpr size_t Size { 256 };
+
+	std::array<ostd::Color, Size> colors;
+	// Multiplies a particle's age in frames into an index
+	float ageScale { 0.0f };
+
+	inline const ostd::Color& sample(uint32_t age) const { return colors[std::min((size_t)((float)age * ageScale), Size - 1)]; }
+};
+
 struct tParticleInfo
 {
 	float lifeSpan { 100 };
@@ -234,45 +270,59 @@ struct tParticleInfo
 		colorRamp.m_colors[colorRamp.m_colors.size() - 1].percent = percent;
 		colorRamp.m_colors[colorRamp.m_colors.size() - 1].updateLength(lifeSpan);
 	}
-};
-
-class Particle : public PhysicsObject
-{
-	public:
-		inline Particle(void) { m_ready = false; }
-		void setup(tParticleInfo partInfo);
-		void beforeUpdate(void) override;
-		void kill(void);
-		inline bool isReady(void) { return m_ready; }
-		inline bool isDead(void) { return m_dead; }
-
-	private:
-		float m_alpha_dec { 0 };
-		bool m_ready { false };
-		bool m_dead { false };
-		bool m_fade_in { true };
-		float m_curr_alpha { 0.0f };
-		float m_fade_in_mult { 1.0f };
-
-	public:
-		float life { 100 };
-		float fullLife { 100 };
-		uint8_t fulLAlpha;
-		float rotationStep { 1.0f };
-		ostd::Color color { 10, 110, 255 };
-		ostd::Vec2 size { 30.0f, 30.0f };
-		TextureRef* texture { nullptr };
-		TextureRef::TextureAtlasIndex tileIndex { TextureRef::FullTextureCoords };
-		float alpha { 0.0f };
-
-		bool dead { false };
-		bool fadeIn { true };
 
-		ColorRamp colorRamp;
+	// Longest a particle can stay visible, in updates. Alpha runs out after half the life,
+	// the fade in adds up to 100 frames scaled by the life
+	inline float maxLifeFrames(void) const
+	{
+		float maxLife = lifeSpan * (1.0f + randomLifeSpan);
+		float frames = std::ceil(maxLife / 2.0f) + 2.0f;
+		if (fadeIn)
+			frames += std::ceil(100.0f * maxLife / std::max(lifeSpan, 1.0f));
+		return frames;
+	}
 };
 
 class ParticleEmitter : public ostd::BaseObject
 {
+	// Particle state as parallel arrays, so the update kernel streams through contiguous
+	// floats. Live particles are kept packed at the front, every slot past the live
+	// count is dead. Capacity is padded to SimdWidth
+	public: struct tParticleBuffer
+	{
+		std::vector<float> posX, posY;
+		std::vector<float> velX, velY;
+		// Per frame velocity multipliers, 1 - damping
+		std::vector<float> dampX, dampY;
+		std::vector<float> life, fullLife;
+		// Target alpha while fading in, remaining alpha while fading out
+		std::vector<float> alpha;
+		std::vector<float> alphaStep;
+		std::vector<float> fadeInAlpha;
+		// Zero once the fade in is done
+		std::vector<float> fadeInStep;
+		// Output alpha of the frame, 0 to 255
+		std::vector<float> colorAlpha;
+		std::vector<float> sizeX, sizeY;
+		// 1.0f or 0.0f, used as a lane mask by the kernel
+		std::vector<float> alive;
+		std::vector<uint32_t> age;
+		std::vector<ostd::Color> color;
+		std::vector<TextureRef*> texture;
+		std::vector<TextureRef::TextureAtlasIndex> tileIndex;
+
+		void resize(size_t count);
+		void move(size_t from, size_t to);
+		inline size_t capacity(void) const { return alive.size(); }
+	};
+
+	public: struct tUpdateStep
+	{
+		float accelX { 0.0f };
+		float accelY { 0.0f };
+		float maxVelocity { 5.0f };
+	};
+
 	public:
 		ParticleEmitter(void);
 		ParticleEmitter(ostd::Rectangle emissionRect, uint32_t maxParticles = 400);
@@ -280,9 +330,12 @@ class ParticleEmitter : public ostd::BaseObject
 		ParticleEmitter& create(ostd::Rectangle emissionRect, uint32_t maxParticles = 400);
 
 		void update(const ostd::Vec2& force = { 0.0f, 0.0f });
+		// Same step as update() without writing vertices, used to fast-forward an emitter.
+		// Colours and tiles are only resolved by the next update()
+		void simulate(const ostd::Vec2& force = { 0.0f, 0.0f });
 		void reset(void);
 
-		void emit(tParticleInfo partInfo, int32_t count = 1);
+		void emit(const tParticleInfo& partInfo, int32_t count = 1);
 		void emit(int32_t count = 1);
 
 		void setDefaultParticleInfo(tParticleInfo info);
@@ -291,8 +344,21 @@ class ParticleEmitter : public ostd::BaseObject
 		inline ostd::Rectangle getEmissionRect(void) { return m_emissionRect; }
 		inline void setWorkingRectangle(ostd::Rectangle rect) { m_workingRect = rect; }
 		inline ostd::Rectangle getWorkingRectangle(void) { return m_workingRect; }
-		inline void setMaxParticleCount(uint32_t maxParticles) { m_particleCount = maxParticles; m_particles.resize(m_particleCount); m_vertexArray.resize(m_particleCount); }
+		inline void setMaxParticleCount(uint32_t maxParticles) { m_particleCount = maxParticles; m_particles.resize(m_particleCount); m_liveCount = 0; m_vertexArray.clear(); }
 		inline uint32_t getMaxParticleCount(void) { return m_particleCount; }
+		inline uint32_t getLiveParticleCount(void) { return m_liveCount; }
+		// Soft cap below the maximum. Particles over it are thinned out a few per update,
+		// the ones closest to the end of their life first
+		inline void setLiveParticleLimit(uint32_t limit) { m_liveLimit = limit; }
+		inline uint32_t getLiveParticleLimit(void) { return std::min(m_liveLimit, m_particleCount); }
+		inline bool isSleeping(void) { return m_liveCount == 0; }
+		// The stream restarts from this seed on every reset()
+		inline void setRandomSeed(uint64_t seed) { m_randomSeed = seed; m_random.seed(seed); }
+		inline tParticleRandom& getRandom(void) { return m_random; }
+		inline const std::vector<TextureRef::TextureAtlasIndex>& getTileArray(void) { return m_tileArray; }
+		// Colour table of the default particle info, null without a colour ramp
+		std::shared_ptr<const tColorLUT> getColorLUT(void);
+		ostd::Vec2 getRandomEmissionPoint(void);
 		inline void useTileArray(bool u = true) { m_useTileArray = u; }
 		inline bool isTileArrayUsed(void) { return m_useTileArray; }
 		void addTilesToArray(const std::vector<TextureRef::TextureAtlasIndex>& array);
@@ -303,23 +369,74 @@ class ParticleEmitter : public ostd::BaseObject
 
 		inline sf::VertexArray& getVertexArray(void) { return m_vertexArray; }
 
+		// Force, velocity clamp, integration, damping, fade and kill for slots [0, count).
+		// Picks the widest kernel the CPU supports, count must be a multiple of SimdWidth
+		static void updateParticles(tParticleBuffer& particles, size_t count, const tUpdateStep& step);
+		static void updateParticlesScalar(tParticleBuffer& particles, size_t begin, size_t end, const tUpdateStep& step);
+		// Times updateParticlesScalar against updateParticles on random particles and checks
+		// that both produce the same state
+		static void runUpdateBenchmark(int32_t emitterCount = 88, int32_t particleCount = 2500, int32_t iterations = 100);
+
 	private:
-		ostd::Vec2 getRandomEmissionPoint(void);
+		void __step(const ostd::Vec2& force, bool writeVertices);
+		void __setup_particle(size_t index, const tParticleInfo& partInfo, const ostd::Vec2& position);
+		void __update_color_lut(const ColorRamp& ramp);
+		void __thin_particles(uint32_t count);
 
 	private:
 		tParticleInfo m_defaultParticle;
-		std::vector<Particle> m_particles;
+		tParticleBuffer m_particles;
+		// Shared with every emitter using the same ramp, null when the ramp is empty
+		std::shared_ptr<const tColorLUT> m_colorLUT;
+		std::vector<tColorInterpolator> m_rampSource;
 		sf::VertexArray m_vertexArray;
 		uint32_t m_particleCount;
+		uint32_t m_liveCount { 0 };
+		uint32_t m_liveLimit { UINT32_MAX };
+		std::vector<uint32_t> m_thinScratch;
+		tParticleRandom m_random;
+		uint64_t m_randomSeed { 0 };
 		ostd::Rectangle m_workingRect;
 		ostd::Rectangle m_emissionRect;
 		std::vector<TextureRef::TextureAtlasIndex> m_tileArray;
+		// m_tileArray indexed by remaining life, 0 to TileLUTSize - 1
+		std::vector<TextureRef::TextureAtlasIndex> m_tileLUT;
 		bool m_useTileArray { false };
 
 		ostd::Spline m_path;
 		float m_currentPathValue { 0.0f };
 		float m_pathStep { 15.0f };
 		ostd::tSplineNode m_currentPathPoint { { 0.0f, 0.0f }, 0.0f };
+
+	public:
+		inline static constexpr size_t SimdWidth { 8 };
+		inline static constexpr float MaxParticleVelocity { 5.0f };
+		inline static constexpr size_t MaxRampFrames { 16384 };
+		inline static constexpr size_t TileLUTSize { 256 };
+		// Share of the particles over the live limit removed per update
+		inline static constexpr float ThinRate { 0.25f };
+};
+
+// Gathers the vertices of many emitters into one stream vertex buffer, so they can be
+// drawn with a single draw call. Falls back to a client side array without VBO support
+class ParticleBatch
+{
+	public:
+		void clear(void);
+		void add(ParticleEmitter& emitter);
+		// Uploads what was added since clear(), call once before drawing
+		void upload(void);
+
+		inline size_t getVertexCount(void) const { return m_vertexCount; }
+		inline bool usesVertexBuffer(void) const { return m_useVertexBuffer; }
+		inline const sf::VertexBuffer& getVertexBuffer(void) const { return m_vertexBuffer; }
+		inline const sf::Vertex* getVertices(void) const { return m_vertices.data(); }
+
+	private:
+		std::vector<sf::Vertex> m_vertices;
+		sf::VertexBuffer m_vertexBuffer { sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream };
+		size_t m_vertexCount { 0 };
+		bool m_useVertexBuffer { false };
 };
 
 class ParticleFactory
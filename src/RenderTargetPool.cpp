@@ -0,0 +1,118 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "RenderTargetPool.hpp"
+#include <ostd/Logger.hpp>
+#include <algorithm>
+
+sf::RenderTexture* RenderTargetPool::acquire(const sf::Vector2u& size, bool smooth)
+{
+	sf::Vector2u _size { std::max(size.x, 1u), std::max(size.y, 1u) };
+	for (auto& entry : m_entries)
+	{
+		if (entry.inUse || entry.size != _size || entry.smooth != smooth) continue;
+		entry.inUse = true;
+		// The previous owner may have left a scissored or offset view behind
+		entry.target->setView(entry.target->getDefaultView());
+		m_stats.targetsInUse++;
+		m_stats.bytesInUse += __byte_size(_size);
+		m_stats.reuses++;
+		return entry.target.get();
+	}
+
+	auto& entry = m_entries.emplace_back();
+	entry.target = std::make_unique<sf::RenderTexture>();
+	if (!entry.target->resize(_size))
+		OX_ERROR("Unable to allocate a %dx%d render target.", _size.x, _size.y);
+	entry.target->setSmooth(smooth);
+	entry.size = _size;
+	entry.smooth = smooth;
+	entry.inUse = true;
+	m_stats.targetCount++;
+	m_stats.targetsInUse++;
+	m_stats.bytesAllocated += __byte_size(_size);
+	m_stats.bytesInUse += __byte_size(_size);
+	m_stats.allocations++;
+	return entry.target.get();
+}
+
+void RenderTargetPool::release(sf::RenderTexture*& target)
+{
+	if (target == nullptr) return;
+	for (auto& entry : m_entries)
+	{
+		if (entry.target.get() != target) continue;
+		if (entry.inUse)
+		{
+			entry.inUse = false;
+			entry.releasedFrame = m_frame;
+			m_stats.targetsInUse--;
+			m_stats.bytesInUse -= __byte_size(entry.size);
+		}
+		break;
+	}
+	target = nullptr;
+}
+
+sf::RenderTexture* RenderTargetPool::reacquire(sf::RenderTexture*& target, const sf::Vector2u& size, bool smooth)
+{
+	// Released first, so a target of the same size and mode comes straight back
+	release(target);
+	target = acquire(size, smooth);
+	return target;
+}
+
+void RenderTargetPool::endFrame(void)
+{
+	// Idle targets are kept until they exceed the budget, so an export at the same
+	// resolution or a resize back to a previous size finds them again
+	m_frame++;
+	uint64_t idleBytes = m_stats.bytesAllocated - m_stats.bytesInUse;
+	while (idleBytes > MaxIdleBytes)
+	{
+		size_t oldest = m_entries.size();
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			if (m_entries[i].inUse) continue;
+			if (oldest == m_entries.size() || m_entries[i].releasedFrame < m_entries[oldest].releasedFrame)
+				oldest = i;
+		}
+		if (oldest == m_entries.size()) break;
+		idleBytes -= __byte_size(m_entries[oldest].size);
+		__evict(oldest);
+	}
+}
+
+void RenderTargetPool::clear(void)
+{
+	m_entries.clear();
+	m_stats.targetCount = 0;
+	m_stats.targetsInUse = 0;
+	m_stats.bytesAllocated = 0;
+	m_stats.bytesInUse = 0;
+}
+
+void RenderTargetPool::__evict(size_t index)
+{
+	m_stats.targetCount--;
+	m_stats.bytesAllocated -= __byte_size(m_entries[index].size);
+	m_stats.evictions++;
+	m_entries.erase(m_entries.begin() + index);
+}
@@ -0,0 +1,73 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <memory>
+#include <vector>
+
+// Owns every offscreen render target. Targets are handed out by size and filtering
+// mode, and released ones are kept around for a while so that a resize back and forth
+// or the next export picks them up again instead of allocating new GL storage.
+class RenderTargetPool
+{
+	public: struct tStats
+	{
+		uint32_t targetCount { 0 };
+		uint32_t targetsInUse { 0 };
+		uint64_t bytesAllocated { 0 };
+		uint64_t bytesInUse { 0 };
+		uint64_t allocations { 0 };
+		uint64_t reuses { 0 };
+		uint64_t evictions { 0 };
+	};
+
+	private: struct tEntry
+	{
+		std::unique_ptr<sf::RenderTexture> target;
+		sf::Vector2u size { 0, 0 };
+		bool smooth { false };
+		bool inUse { false };
+		uint64_t releasedFrame { 0 };
+	};
+
+	public:
+		sf::RenderTexture* acquire(const sf::Vector2u& size, bool smooth = false);
+		void release(sf::RenderTexture*& target);
+		sf::RenderTexture* reacquire(sf::RenderTexture*& target, const sf::Vector2u& size, bool smooth = false);
+		void endFrame(void);
+		void clear(void);
+
+		inline const tStats& getStats(void) const { return m_stats; }
+
+	private:
+		void __evict(size_t index);
+		inline static uint64_t __byte_size(const sf::Vector2u& size) { return (uint64_t)size.x * size.y * 4; }
+
+	private:
+		std::vector<tEntry> m_entries;
+		tStats m_stats;
+		uint64_t m_frame { 0 };
+
+	public:
+		// Least recently released targets are freed once the idle ones exceed this
+		inline static constexpr uint64_t MaxIdleBytes { 128ull * 1024 * 1024 };
+};
@@ -146,6 +146,39 @@ void Renderer::drawParticleSysten(ParticleEmitter& emitter)
 	__draw_call(&(emitter.getVertexArray()));
 }
 
+void Renderer::drawParticleBatch(const ParticleBatch& batch)
+{
+	if (m_window == nullptr) return;
+	if (batch.getVertexCount() == 0) return;
+	sf::RenderTarget& target = (m_target == nullptr ? m_window->sfWindow() : *m_target);
+	if (batch.usesVertexBuffer())
+		target.draw(batch.getVertexBuffer(), 0, batch.getVertexCount(), __current_states());
+	else
+		target.draw(batch.getVertices(), batch.getVertexCount(), sf::PrimitiveType::Triangles, __current_states());
+}
+
+void Renderer::drawVertexArray(const sf::VertexArray& vertices)
+{
+	if (m_window == nullptr) return;
+	if (vertices.getVertexCount() == 0) return;
+	__draw_call(&vertices);
+}
+
+void Renderer::drawVertexBuffer(const sf::VertexBuffer& buffer)
+{
+	if (m_window == nullptr) return;
+	if (buffer.getVertexCount() == 0) return;
+	__draw_call(&buffer);
+}
+
+void Renderer::drawVertexBuffer(const sf::VertexBuffer& buffer, size_t firstVertex, size_t vertexCount)
+{
+	if (m_window == nullptr) return;
+	if (vertexCount == 0 || firstVertex + vertexCount > buffer.getVertexCount()) return;
+	sf::RenderTarget& target = (m_target == nullptr ? m_window->sfWindow() : *m_target);
+	target.draw(buffer, firstVertex, vertexCount, __current_states());
+}
+
 void Renderer::fillRect(const ostd::Rectangle& rect, const ostd::Color& fillColor)
 {
 	if (m_window == nullptr) return;
@@ -240,3 +273,12 @@ void Renderer::__draw_call(const sf::Drawable* obj)
 	else
 		target.draw(*obj);
 }
+
+sf::RenderStates Renderer::__current_states(void)
+{
+	if (m_renderStates != nullptr)
+		return *m_renderStates;
+	sf::RenderStates states = sf::RenderStates::Default;
+	states.shader = m_shader;
+	return states;
+}
@@ -53,6 +53,10 @@ class Renderer
 		static void drawTexture(const sf::Texture& texture, const ostd::Vec2& position = { 0, 0 }, const ostd::Vec2& scale = { 1.0f, 1.0f }, const ostd::Color& tint = { 255, 255, 255, 255 });
 		static void drawSprite(const sf::Sprite& sprite);
 		static void drawParticleSysten(ParticleEmitter& emitter);
+		static void drawParticleBatch(const ParticleBatch& batch);
+		static void drawVertexBuffer(const sf::VertexBuffer& buffer);
+		static void drawVertexBuffer(const sf::VertexBuffer& buffer, size_t firstVertex, size_t vertexCount);
+		static void drawVertexArray(const sf::VertexArray& vertices);
 
 		static void drawRect(const ostd::Rectangle& rect, const ostd::Color& outlineColor, int32_t outlineThickness = -1);
 		static void fillRect(const ostd::Rectangle& rect, const ostd::Color& fillColor);
@@ -64,6 +68,7 @@ class Renderer
 
 	private:
 		static void __draw_call(const sf::Drawable* obj);
+		static sf::RenderStates __current_states(void);
 
 	private:
 		inline static sf::RenderTarget* m_target { nullptr };
@@ -66,12 +66,27 @@ void WindowBase::close(void)
 void WindowBase::update(void)
 {
 	if (!m_initialized) return;
-	__handle_events();
+	// Idle: sleep in waitEvent and only redraw when an event arrived, plus a slow
+	// refresh in case the window system dropped the last frame. Events keep the
+	// loop awake for a grace period so GUI hover and focus effects can settle
+	if (canIdle() && m_activityClock.getElapsedTime().asMilliseconds() > IdleGracePeriod_ms)
+	{
+		bool hadEvents = __wait_for_events();
+		if (!hadEvents && m_idleRefreshClock.getElapsedTime().asMilliseconds() < IdleRefreshInterval_ms)
+		{
+			m_fixedUpdateTImer.update();
+			return;
+		}
+	}
+	else
+		__handle_events();
+	m_idleRefreshClock.restart();
 	m_window.clear({ m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a });
 	m_fixedUpdateTImer.update();
 	onUpdate();
 	onRender();
 	m_window.display();
+	onFrameDisplayed();
 	m_frameTimeAcc += m_fpsUpdateClock.restart().asSeconds();
 	m_frameCount++;
 	m_fpsUpdateTimer.update();
@@ -100,6 +115,22 @@ void WindowBase::setTitle(const ostd::String& title)
 void WindowBase::__handle_events(void)
 {
 	if (!isInitialized()) return;
+	while (const std::optional event = m_window.pollEvent())
+		__dispatch_event(event);
+}
+
+bool WindowBase::__wait_for_events(void)
+{
+	const std::optional event = m_window.waitEvent(sf::milliseconds(IdleWaitTimeout_ms));
+	if (!event) return false;
+	__dispatch_event(event);
+	__handle_events();
+	return true;
+}
+
+void WindowBase::__dispatch_event(const std::optional<sf::Event>& event)
+{
+	m_activityClock.restart();
 	auto l_getMouseState = [this](void) -> MouseEventData {
 		sf::Vector2i pos = sf::Mouse::getPosition(m_window);
 		bool leftPressed   = sf::Mouse::isButtonPressed(sf::Mouse::Button::Left);
@@ -112,77 +143,74 @@ void WindowBase::__handle_events(void)
 		MouseEventData mmd(*this, pos.x, pos.y, button);
 		return mmd;
 	};
-	while (const std::optional event = m_window.pollEvent())
+	onEventPoll(event);
+	if (event->is<sf::Event::Closed>())
 	{
-		onEventPoll(event);
-		if (event->is<sf::Event::Closed>())
-		{
-			m_running = false;
-			onClose();
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::WindowClosed, ostd::tSignalPriority::RealTime, *this);
-		}
-		else if (event->is<sf::Event::Resized>())
-		{
-			const auto* resized = event->getIf<sf::Event::Resized>();
-			WindowResizedData wrd(*this, m_windowWidth, m_windowHeight, 0, 0);
-			m_windowWidth = resized->size.x;
-			m_windowHeight = resized->size.y;
-			wrd.new_width = m_windowWidth;
-			wrd.new_height = m_windowHeight;
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::WindowResized, ostd::tSignalPriority::RealTime, wrd);
-		}
-		else if (event->is<sf::Event::FocusLost>())
-		{
-			ostd::SignalHandler::emitSignal(WindowFocusLost, ostd::tSignalPriority::RealTime, *this);
-		}
-		else if (event->is<sf::Event::FocusGained>())
-		{
-			ostd::SignalHandler::emitSignal(WindowFocusGained, ostd::tSignalPriority::RealTime, *this);
-		}
-		else if (event->is<sf::Event::MouseMoved>())
-		{
-			MouseEventData mmd = l_getMouseState();
-			if (isMouseDragEventEnabled() && mmd.button != MouseEventData::eButton::_None)
-				ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseDragged, ostd::tSignalPriority::RealTime, mmd);
-			else
-				ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseMoved, ostd::tSignalPriority::RealTime, mmd);
-		}
-		else if (event->is<sf::Event::MouseButtonPressed>())
-		{
-			MouseEventData mmd = l_getMouseState();
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MousePressed, ostd::tSignalPriority::RealTime, mmd);
-		}
-		else if (event->is<sf::Event::MouseButtonReleased>())
-		{
-			MouseEventData mmd = l_getMouseState();
-			const auto* released = event->getIf<sf::Event::MouseButtonReleased>();
-			if (released->button == sf::Mouse::Button::Left)
-				mmd.button = MouseEventData::eButton::Left;
-			else if (released->button == sf::Mouse::Button::Right)
-				mmd.button = MouseEventData::eButton::Right;
-			else if (released->button == sf::Mouse::Button::Middle)
-				mmd.button = MouseEventData::eButton::Middle;
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseReleased, ostd::tSignalPriority::RealTime, mmd);
-		}
-		else if (event->is<sf::Event::KeyPressed>())
-		{
-			const auto* keyPressed = event->getIf<sf::Event::KeyPressed>();
-			KeyEventData ked(*this, (int32_t)keyPressed->code, 0, KeyEventData::eKeyEvent::Pressed);
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::KeyPressed, ostd::tSignalPriority::RealTime, ked);
-		}
-		else if (event->is<sf::Event::KeyReleased>())
-		{
-			const auto* keyReleased = event->getIf<sf::Event::KeyReleased>();
-			KeyEventData ked(*this, (int32_t)keyReleased->code, 0, KeyEventData::eKeyEvent::Released);
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::KeyReleased, ostd::tSignalPriority::RealTime, ked);
-		}
-		else if (event->is<sf::Event::TextEntered>())
-		{
-			const auto* textEntered = event->getIf<sf::Event::TextEntered>();
-			char32_t codepoint = textEntered->unicode;
-			KeyEventData ked(*this, 0, static_cast<char>(codepoint), KeyEventData::eKeyEvent::Text);
-			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::TextEntered, ostd::tSignalPriority::RealTime, ked);
-		}
+		m_running = false;
+		onClose();
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::WindowClosed, ostd::tSignalPriority::RealTime, *this);
+	}
+	else if (event->is<sf::Event::Resized>())
+	{
+		const auto* resized = event->getIf<sf::Event::Resized>();
+		WindowResizedData wrd(*this, m_windowWidth, m_windowHeight, 0, 0);
+		m_windowWidth = resized->size.x;
+		m_windowHeight = resized->size.y;
+		wrd.new_width = m_windowWidth;
+		wrd.new_height = m_windowHeight;
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::WindowResized, ostd::tSignalPriority::RealTime, wrd);
+	}
+	else if (event->is<sf::Event::FocusLost>())
+	{
+		ostd::SignalHandler::emitSignal(WindowFocusLost, ostd::tSignalPriority::RealTime, *this);
+	}
+	else if (event->is<sf::Event::FocusGained>())
+	{
+		ostd::SignalHandler::emitSignal(WindowFocusGained, ostd::tSignalPriority::RealTime, *this);
+	}
+	else if (event->is<sf::Event::MouseMoved>())
+	{
+		MouseEventData mmd = l_getMouseState();
+		if (isMouseDragEventEnabled() && mmd.button != MouseEventData::eButton::_None)
+			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseDragged, ostd::tSignalPriority::RealTime, mmd);
+		else
+			ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseMoved, ostd::tSignalPriority::RealTime, mmd);
+	}
+	else if (event->is<sf::Event::MouseButtonPressed>())
+	{
+		MouseEventData mmd = l_getMouseState();
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MousePressed, ostd::tSignalPriority::RealTime, mmd);
+	}
+	else if (event->is<sf::Event::MouseButtonReleased>())
+	{
+		MouseEventData mmd = l_getMouseState();
+		const auto* released = event->getIf<sf::Event::MouseButtonReleased>();
+		if (released->button == sf::Mouse::Button::Left)
+			mmd.button = MouseEventData::eButton::Left;
+		else if (released->button == sf::Mouse::Button::Right)
+			mmd.button = MouseEventData::eButton::Right;
+		else if (released->button == sf::Mouse::Button::Middle)
+			mmd.button = MouseEventData::eButton::Middle;
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::MouseReleased, ostd::tSignalPriority::RealTime, mmd);
+	}
+	else if (event->is<sf::Event::KeyPressed>())
+	{
+		const auto* keyPressed = event->getIf<sf::Event::KeyPressed>();
+		KeyEventData ked(*this, (int32_t)keyPressed->code, 0, KeyEventData::eKeyEvent::Pressed);
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::KeyPressed, ostd::tSignalPriority::RealTime, ked);
+	}
+	else if (event->is<sf::Event::KeyReleased>())
+	{
+		const auto* keyReleased = event->getIf<sf::Event::KeyReleased>();
+		KeyEventData ked(*this, (int32_t)keyReleased->code, 0, KeyEventData::eKeyEvent::Released);
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::KeyReleased, ostd::tSignalPriority::RealTime, ked);
+	}
+	else if (event->is<sf::Event::TextEntered>())
+	{
+		const auto* textEntered = event->getIf<sf::Event::TextEntered>();
+		char32_t codepoint = textEntered->unicode;
+		KeyEventData ked(*this, 0, static_cast<char>(codepoint), KeyEventData::eKeyEvent::Text);
+		ostd::SignalHandler::emitSignal(ostd::tBuiltinSignals::TextEntered, ostd::tSignalPriority::RealTime, ked);
 	}
 }
 
@@ -45,12 +45,16 @@ class WindowBase : public ostd::BaseObject
 		void setTitle(const ostd::String& title);
 
 		inline virtual void onRender(void) { }
+		inline virtual void onFrameDisplayed(void) { }
 		inline virtual void onUpdate(void) { }
 		inline virtual void onFixedUpdate(double frameTime_s) { }
 		inline virtual void onInitialize(void) { }
 		inline virtual void onDestroy(void) { }
 		inline virtual void onClose(void) { }
 		inline virtual void onEventPoll(const std::optional<sf::Event>& event) { }
+		// Return true while nothing on screen changes on its own, to let update() block
+		// on events instead of redrawing the same frame
+		inline virtual bool canIdle(void) { return false; }
 
 		inline bool	isInitialized(void) const { return m_initialized; }
 		inline bool	isRunning(void) const { return m_running; }
@@ -71,6 +75,8 @@ class WindowBase : public ostd::BaseObject
 
 	private:
 		void __handle_events(void);
+		bool __wait_for_events(void);
+		void __dispatch_event(const std::optional<sf::Event>& event);
 
 
 	protected:
@@ -91,11 +97,18 @@ class WindowBase : public ostd::BaseObject
 		double m_frameTimeAcc { 0.0 };
 		int32_t m_frameCount { 0 };
 
+		sf::Clock m_activityClock;
+		sf::Clock m_idleRefreshClock;
+
 		bool m_deagEventEnabled { false };
 		bool m_running { false };
 		bool m_initialized { false };
 
 	public:
+		inline static constexpr int32_t IdleWaitTimeout_ms { 250 };
+		inline static constexpr int32_t IdleGracePeriod_ms { 500 };
+		inline static constexpr int32_t IdleRefreshInterval_ms { 1000 };
+
 		inline static const uint64_t WindowFocusLost   = ostd::SignalHandler::newCustomSignal(6000);
 		inline static const uint64_t WindowFocusGained = ostd::SignalHandler::newCustomSignal(6001);
 };
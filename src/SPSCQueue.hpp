@@ -0,0 +1,62 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+	public:
+		inline bool push(const T& value)
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+				return false;
+			m_buffer[tail & (Capacity - 1)] = value;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		inline bool pop(T& outValue)
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+			outValue = m_buffer[head & (Capacity - 1)];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		inline bool empty(void) const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+		inline void clear(void) { m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release); }
+
+	private:
+		// Head and tail live on separate cache lines so the two threads never share one
+		alignas(64) std::atomic<size_t> m_head { 0 };
+		alignas(64) std::atomic<size_t> m_tail { 0 };
+		std::array<T, Capacity> m_buffer;
+};
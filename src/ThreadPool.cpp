@@ -0,0 +1,103 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	m_workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; i++)
+		m_workers.emplace_back(&ThreadPool::__worker_loop, this);
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeCondition.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& func)
+{
+	if (count == 0) return;
+	grainSize = std::max<size_t>(grainSize, 1);
+	if (m_workers.empty() || count <= grainSize)
+	{
+		func(0, count);
+		return;
+	}
+
+	// One loop at a time; callers on other threads queue up here
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &func;
+		m_jobCount = count;
+		m_jobGrain = grainSize;
+		m_nextIndex.store(0, std::memory_order_relaxed);
+		m_busyWorkers = (uint32_t)m_workers.size();
+		m_generation++;
+	}
+	m_wakeCondition.notify_all();
+	__run_chunks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_busyWorkers == 0; });
+	m_job = nullptr;
+}
+
+ThreadPool& ThreadPool::shared(void)
+{
+	static ThreadPool s_pool;
+	return s_pool;
+}
+
+void ThreadPool::__worker_loop(void)
+{
+	uint64_t seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this, seenGeneration]() { return m_stop || m_generation != seenGeneration; });
+			if (m_stop) return;
+			seenGeneration = m_generation;
+		}
+		__run_chunks();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyWorkers--;
+		}
+		m_doneCondition.notify_one();
+	}
+}
+
+void ThreadPool::__run_chunks(void)
+{
+	for (size_t begin = m_nextIndex.fetch_add(m_jobGrain); begin < m_jobCount; begin = m_nextIndex.fetch_add(m_jobGrain))
+		(*m_job)(begin, std::min(begin + m_jobGrain, m_jobCount));
+}
@@ -0,0 +1,64 @@
+/*
+    KeyLight - A MIDI Piano Visualizer
+    Copyright (C) 2025  OmniaX-Dev
+
+    This file is part of KeyLight.
+
+    KeyLight is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    KeyLight is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with KeyLight.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor() blocks until
+// every chunk is done and the calling thread works on chunks too.
+class ThreadPool
+{
+	public:
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool(void);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& func);
+		inline uint32_t getThreadCount(void) const { return (uint32_t)m_workers.size() + 1; }
+
+		static ThreadPool& shared(void);
+
+	private:
+		void __worker_loop(void);
+		void __run_chunks(void);
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex m_submitMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_wakeCondition;
+		std::condition_variable m_doneCondition;
+
+		const std::function<void(size_t, size_t)>* m_job { nullptr };
+		size_t m_jobCount { 0 };
+		size_t m_jobGrain { 1 };
+		std::atomic<size_t> m_nextIndex { 0 };
+		uint32_t m_busyWorkers { 0 };
+		uint64_t m_generation { 0 };
+		bool m_stop { false };
+};
@@ -20,6 +20,8 @@
 
 #include "VPianoData.hpp"
 #include <ostd/Logger.hpp>
+#include <algorithm>
+#include <cmath>
 
 
 // VirtualPianoData
@@ -56,6 +58,7 @@ VirtualPianoData::VirtualPianoData(void)
 	pianoLineColor2 = { 160, 10, 10 };
 
 	usePerNoteColors = false;
+	useStaticNoteMesh = true;
 
 	for (int32_t i = 0; i < 36; i++)
 		perNoteColors[i] = { 0, 0, 0 };
@@ -83,10 +86,17 @@ VirtualPianoData::VirtualPianoData(void)
 	blur.startRadius = 1.0f;
 	blur.threshold = 0.1f;
 	blur.type = eBlurType::Gaussian;
+	blur.useGlowSlices = true;
 }
 
 void VirtualPianoData::loadFromStyleJSON(ostd::JsonFile& styleJson)
 {
+	// Keys added after the first style format, missing from older user styles
+	auto l_getOptionalBool = [&styleJson](const ostd::String& key, bool defaultValue) -> bool {
+		if (!styleJson.has(key)) return defaultValue;
+		return styleJson.get_bool(key);
+	};
+
 	whiteKeyWidth = styleJson.get_float("style.dimensions.whiteKeyWidth");
 	float mul = styleJson.get_float("style.dimensions.whiteKeyHeightMultiplier");
 	whiteKeyHeight = whiteKeyWidth * mul;
@@ -109,6 +119,7 @@ void VirtualPianoData::loadFromStyleJSON(ostd::JsonFile& styleJson)
 	fallingTime_s = styleJson.get_float("style.dimensions.noteFallingTime_seconds");
 
 	usePerNoteColors = styleJson.get_bool("style.usePerNoteColors");
+	useStaticNoteMesh = l_getOptionalBool("style.useStaticNoteMesh", DefaultUseStaticNoteMesh);
 
 	fallingWhiteNoteColor = styleJson.get_color("style.colors.fallingWhiteNote");
 	fallingWhiteNoteOutlineColor = styleJson.get_color("style.colors.fallingWhiteNoteOutline");
@@ -181,6 +192,8 @@ void VirtualPianoData::loadFromStyleJSON(ostd::JsonFile& styleJson)
 	blur.bloomIntensity = styleJson.get_float("style.blur.bloomIntensity");
 	blur.threshold = styleJson.get_int("style.blur.threshold");
 	blur.resolutionDivider = styleJson.get_int("style.blur.resolutionSubdivider");
+	blur.useGlowSlices = l_getOptionalBool("style.blur.useGlowSlices", DefaultUseGlowSlices);
+	blur.temporalReuse = l_getOptionalBool("style.blur.temporalReuse", DefaultTemporalReuse);
 
 	ostd::String type = styleJson.get_string("style.blur.type").new_trim();
 	if (type == "gaussian") blur.type = eBlurType::Gaussian;
@@ -216,6 +229,53 @@ void VirtualPianoData::recalculateKeyOffsets(void)
 	}
 }
 
+int32_t VirtualPianoData::BlurData::getPassCount(void) const
+{
+	// The Kawase pyramid stops at its last level, passes past that are never run
+	if (type == eBlurType::Kawase)
+		return std::min<int32_t>(passes, MaxKawaseLevels);
+	return passes;
+}
+
+float VirtualPianoData::BlurData::getEffectiveSigma(void) const
+{
+	// Variances of independent blur passes add up. One gaussianBlur.frag pass has a
+	// variance of 2.854 * radius^2 along its direction, a dual Kawase down/up pair
+	// has offset^2 / 8 + offset^2 / 3
+	double variance = 0.0;
+	float radius = startRadius;
+	int32_t passCount = getPassCount();
+	for (int32_t i = 0; i < passCount; i++)
+	{
+		if (type == eBlurType::Kawase)
+			variance += (radius * radius / 8.0) + (radius * radius / 3.0);
+		else
+			variance += 2.854 * radius * radius;
+		radius += increment;
+	}
+	return std::max((float)std::sqrt(variance) * resolutionDivider, 0.5f);
+}
+
+float VirtualPianoData::BlurData::getGain(void) const
+{
+	// Every pass scales by bloomIntensity, twice per iteration in both blur types
+	return std::pow(bloomIntensity, 2.0f * getPassCount());
+}
+
+ostd::Color VirtualPianoData::BlurData::prepareSliceGlowColor(const ostd::Color& color) const
+{
+	// Applies what the blur threshold and gain do to a solid glow shape, so the
+	// slice texture only has to carry the falloff. RGB is premultiplied, like the
+	// glow buffer after the shape is drawn onto a transparent target
+	float alpha = color.a / 255.0f;
+	float r = color.r / 255.0f * alpha, g = color.g / 255.0f * alpha, b = color.b / 255.0f * alpha;
+	float brightness = (r * 0.2126f) + (g * 0.7152f) + (b * 0.0722f);
+	float amount = (threshold < 1.0f ? std::clamp((brightness - threshold) / (1.0f - threshold), 0.0f, 1.0f) : 0.0f);
+	float gain = getGain();
+	auto l_toByte = [](float value) -> uint8_t { return (uint8_t)std::clamp(value * 255.0f, 0.0f, 255.0f); };
+	return { l_toByte(r * amount * gain), l_toByte(g * amount * gain), l_toByte(b * amount * gain), l_toByte(alpha * gain) };
+}
+
 void VirtualPianoData::updateScale(int32_t width, int32_t height)
 {
 	scale_x = (float)width / (float)base_width;
@@ -33,6 +33,7 @@
 #include <vector>
 #include "Common.hpp"
 #include "Particles.hpp"
+#include "NoteStore.hpp"
 #include "ffmpeg_helper.hpp"
 #include <boost/process/v1.hpp>
 
@@ -62,6 +63,18 @@ struct VirtualPianoData
 		uint8_t resolutionDivider { 1 };
 		float bloomIntensity { 1.0f };
 		eBlurType type { eBlurType::Gaussian };
+		bool useGlowSlices { true };
+		bool temporalReuse { true };
+
+		// Standard deviation (in window pixels) and total gain of the whole pass chain,
+		// used to bake the same falloff into the glow slice textures
+		int32_t getPassCount(void) const;
+		float getEffectiveSigma(void) const;
+		float getGain(void) const;
+		ostd::Color prepareSliceGlowColor(const ostd::Color& color) const;
+
+		// Depth of the dual Kawase pyramid, one level per pass
+		inline static constexpr int32_t MaxKawaseLevels { 6 };
 	};
 
 	private:
@@ -119,6 +132,7 @@ struct VirtualPianoData
 		ostd::Color pianoLineColor2 = { 0, 0, 0 };
 
 		bool usePerNoteColors { false };
+		bool useStaticNoteMesh { true };
 		ostd::Color perNoteColors[36] = {
 			{ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 },
 			{ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 },
@@ -174,6 +188,13 @@ struct VirtualPianoData
 		inline ostd::Rectangle getGlowMargins(void) const { return { glowMargins.x * scale_x, glowMargins.y * scale_y,
 																	 glowMargins.w * scale_x, glowMargins.h * scale_y }; }
 		inline std::unordered_map<int32_t, float>& keyOffsets(void) { recalculateKeyOffsets(); return _keyOffsets;}
+
+	public:
+		// Used when a style file predates the key. All three only change how the same
+		// picture is drawn, so older styles get the faster paths too
+		inline static constexpr bool DefaultUseStaticNoteMesh { true };
+		inline static constexpr bool DefaultUseGlowSlices { true };
+		inline static constexpr bool DefaultTemporalReuse { true };
 };
 class NoteEventData : public ostd::BaseObject
 {
@@ -181,7 +202,7 @@ class NoteEventData : public ostd::BaseObject
 	public:
 		NoteEventData(PianoKey& key) : vPianoKey(key) { setTypeName("VirtualPiano::NoteEventData"); validate(); }
 		PianoKey& vPianoKey;
-		ostd::MidiParser::NoteEvent note;
+		PackedNote note;
 		eEventType eventType;
 };
 struct FallingNoteGraphicsData
@@ -236,8 +257,7 @@ struct VideoRenderState
 		oldScale = { 0.0f, 0.0f };
 		resolution = { 0, 0 };
 
-		renderTarget = sf::RenderTexture();
-		flippedRenderTarget = sf::RenderTexture();
+		renderTarget = nullptr;
 
 		frameIndex = 0;
 		renderFPS = 0;
@@ -269,8 +289,8 @@ struct VideoRenderState
 	ostd::Vec2 oldScale { 0.0f, 0.0f };
 	ostd::UI16Point resolution { 0, 0 };
 
-	sf::RenderTexture renderTarget;
-	sf::RenderTexture flippedRenderTarget;
+	// Borrowed from VPianoResources::renderTargets for the duration of an export
+	sf::RenderTexture* renderTarget { nullptr };
 
 	int32_t frameIndex { 0 };
 	int32_t renderFPS { 0 };
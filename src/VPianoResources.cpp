@@ -20,6 +20,12 @@
 
 #include "VPianoResources.hpp"
 #include <ostd/Logger.hpp>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <optional>
 #include "VirtualPiano.hpp"
 #include "Window.hpp"
 
@@ -44,12 +50,19 @@ bool VPianoResources::loadShaders(void)
 		return true;
 	};
 	if (!load_shader(noteShader, "note")) return false;
-	if (!load_shader(thresholdShader, "threshold")) return false;
 	if (!load_shader(kawaseUpShader, "dualKawaseUp")) return false;
 	if (!load_shader(kawaseDownShader, "dualKawaseDown")) return false;
 	if (!load_shader(gaussianBlurShader, "gaussianBlur")) return false;
-	if (!load_shader(flipShader, "flip")) return false;
+	if (!load_shader(bloomCompositeShader, "bloomComposite")) return false;
 	if (!load_shader(particleShader, "particle")) return false;
+	// Optional: without it falling notes are built on the CPU every frame
+	noteMeshShaderLoaded = load_shader(noteMeshShader, "noteMesh", "noteMesh");
+	if (!noteMeshShaderLoaded)
+		OX_WARN("Static note mesh disabled, falling back to per-frame note geometry.");
+	// Optional: without it particles are always simulated on the CPU
+	analyticParticleShaderLoaded = load_shader(analyticParticleShader, "particle", "analyticParticle");
+	if (!analyticParticleShaderLoaded)
+		OX_WARN("Analytic particles disabled, falling back to simulated particles.");
 	return true;
 }
 
@@ -104,6 +117,108 @@ bool VPianoResources::loadNoteTexture(const ostd::String& filePath)
 	return true;
 }
 
+bool VPianoResources::bakeGlowSlices(const VirtualPianoData& vpd)
+{
+	glowSlicesReady = false;
+	if (!vpd.blur.useGlowSlices) return false;
+	glowSliceSigma = vpd.blur.getEffectiveSigma();
+	glowSliceExtent = (int32_t)std::ceil(glowSliceSigma * 3.0f);
+	if (!__bake_glow_slice()) return false;
+	glowSlicesReady = true;
+	OX_DEBUG("Baked glow slices: sigma=%.2f, size=%dx%d.", glowSliceSigma, glowSliceTexture.getSize().x, glowSliceTexture.getSize().y);
+	return true;
+}
+
+float VPianoResources::getGlowProfile(float t, float length) const
+{
+	// Gaussian blur of the segment [extent, extent + length)
+	float scale = 1.0f / (glowSliceSigma * std::sqrt(2.0f));
+	float start = t - (float)glowSliceExtent;
+	return 0.5f * (std::erf(start * scale) - std::erf((start - length) * scale));
+}
+
+float VPianoResources::getGlowSliceTexel(float t, float length) const
+{
+	// Up to the longest row, the row is scaled onto the span. Past it, both falloffs
+	// map 1:1 and the flat middle is stretched. Mirrored in noteMesh.frag
+	float maxLength = (float)getGlowSliceRowCount();
+	float edge = (float)glowSliceExtent * 2.0f;
+	float span = length + edge;
+	float rowSpan = std::clamp(std::round(length), 1.0f, maxLength) + edge;
+	if (length <= maxLength)
+		return t * rowSpan / span;
+	return (t < span * 0.5f ? std::min(t, edge) : rowSpan - std::min(span - t, edge));
+}
+
+void VPianoResources::buildGaussianKernel(const VirtualPianoData& vpd, float sceneScale)
+{
+	// The configured pass chain is reduced to the one sigma it adds up to, measured in
+	// blur buffer texels. The buffers shrink with the scene scale, so do the texels the
+	// same sigma in window pixels takes. When the kernel does not fit the uniform arrays,
+	// it is split into the fewest equal passes that do, since variances of passes add up
+	auto& kernel = gaussianKernel;
+	float sigma = vpd.blur.getEffectiveSigma() * sceneScale / std::max<float>(vpd.blur.resolutionDivider, 1.0f);
+	int32_t maxRadius = ((int32_t)kernel.offsets.size() - 1) * 2;
+	kernel.passes = std::max((int32_t)std::ceil(std::pow(sigma * 3.0f / maxRadius, 2.0f)), 1);
+	float passSigma = sigma / std::sqrt((float)kernel.passes);
+	int32_t radius = std::min((int32_t)std::ceil(passSigma * 3.0f), maxRadius);
+
+	std::vector<float> discrete(radius + 2, 0.0f);
+	float sum = 0.0f;
+	for (int32_t i = 0; i <= radius; i++)
+	{
+		discrete[i] = std::exp(-(float)(i * i) / (2.0f * passSigma * passSigma));
+		sum += (i == 0 ? discrete[i] : discrete[i] * 2.0f);
+	}
+	for (auto& weight : discrete)
+		weight /= sum;
+
+	// Texels i and i+1 share one bilinear fetch placed at their weighted centre
+	kernel.offsets[0] = 0.0f;
+	kernel.weights[0] = discrete[0];
+	kernel.tapCount = 1;
+	for (int32_t i = 1; i <= radius; i += 2)
+	{
+		float weight = discrete[i] + discrete[i + 1];
+		kernel.offsets[kernel.tapCount] = ((i * discrete[i]) + ((i + 1) * discrete[i + 1])) / weight;
+		kernel.weights[kernel.tapCount] = weight;
+		kernel.tapCount++;
+	}
+	// Same total gain as the chain it replaces, spread over both directions of every pass
+	kernel.passIntensity = std::pow(vpd.blur.getGain(), 1.0f / (2.0f * kernel.passes));
+	OX_DEBUG("Gaussian kernel: sigma=%.2f, %d pass(es), %d taps.", sigma, kernel.passes, kernel.tapCount);
+}
+
+bool VPianoResources::__bake_glow_slice(void)
+{
+	// A blurred box is the product of its blurred width and height, so one row per
+	// segment length covers every note size. Rows go up to the length where the middle
+	// reaches full brightness, so narrow and short notes keep the dimmer peak of the
+	// real blur. The corner arc is left out, its share of the kernel is negligible
+	// while the corner radius is small against sigma
+	int32_t rows = getGlowSliceRowCount();
+	int32_t width = rows + (glowSliceExtent * 2);
+	sf::Image image({ (uint32_t)width, (uint32_t)rows });
+	for (int32_t row = 0; row < rows; row++)
+	{
+		float length = (float)(row + 1);
+		float span = length + (glowSliceExtent * 2.0f);
+		for (int32_t x = 0; x < width; x++)
+		{
+			float profile = (x < span ? getGlowProfile(x + 0.5f, length) : 0.0f);
+			uint8_t value = (uint8_t)std::clamp(profile * 255.0f + 0.5f, 0.0f, 255.0f);
+			image.setPixel({ (uint32_t)x, (uint32_t)row }, { value, value, value, value });
+		}
+	}
+	if (!glowSliceTexture.loadFromImage(image))
+	{
+		OX_ERROR("Unable to create glow slice texture.");
+		return false;
+	}
+	glowSliceTexture.setSmooth(true);
+	return true;
+}
+
 bool VPianoResources::loadAudioFile(const ostd::String& filePath)
 {
 	_hasAudioFile = false;
@@ -126,21 +241,52 @@ bool VPianoResources::loadMidiFile(const ostd::String& filePath)
 	try
 	{
 		midiNotes.clear();
-		midiNotes = ostd::MidiParser::parseFile(filePath);
-		for (auto& note : midiNotes)
+		firstNoteStartTime = 0.0;
+		lastNoteEndTime = 0.0;
+		maxNoteDuration = 0.0;
+
+		// The cache stores the final timeline, so the falling time offset is part of its key
+		double fallingTime = vpiano.m_vPianoData.fallingTime_s;
+		uint64_t timeBits = 0;
+		std::memcpy(&timeBits, &fallingTime, sizeof(timeBits));
+		uint64_t cacheKey = NoteStore::hashFile(filePath, timeBits);
+		ostd::String cachePath = std::filesystem::path(filePath.cpp_str()).replace_extension(".klnotes").string();
+
+		NoteStore::tCacheHeader header;
+		if (cacheKey != 0 && midiNotes.mapCacheFile(cachePath, cacheKey, header))
 		{
-			note.startTime += vpiano.m_vPianoData.fallingTime_s;
-			note.endTime   += vpiano.m_vPianoData.fallingTime_s;
+			firstNoteStartTime = header.firstNoteStartTime;
+			lastNoteEndTime = header.lastNoteEndTime;
+			maxNoteDuration = header.maxNoteDuration;
+			OX_DEBUG("loaded <%s> from note cache: %d notes.", filePath.c_str(), (int32_t)midiNotes.size());
+			buildNoteLOD();
+			return true;
+		}
 
-			if (note.first)
-				firstNoteStartTime = note.startTime;
-			else if (note.last)
-				lastNoteEndTime = note.startTime;
+		auto loadStart = std::chrono::steady_clock::now();
+		MidiLoader::tResult result;
+		if (!MidiLoader::loadFile(filePath, fallingTime, result))
+		{
+			OX_WARN("Unable to decode <%s> with the track loader, falling back to ostd::MidiParser.", filePath.c_str());
+			__parse_midi_fallback(filePath, fallingTime, result);
 		}
-		std::sort(midiNotes.begin(), midiNotes.end());
-		OX_DEBUG("loaded <%s>: total notes parsed: %f", filePath.c_str(), midiNotes.size());
+		double loadTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+		firstNoteStartTime = result.firstNoteStartTime;
+		lastNoteEndTime = result.lastNoteEndTime;
+		maxNoteDuration = result.maxNoteDuration;
+		midiNotes.assign(std::move(result.notes));
+		OX_DEBUG("  Parsed %d tracks in %f ms.", result.trackCount, loadTime_ms);
+		OX_DEBUG("loaded <%s>: total notes parsed: %d", filePath.c_str(), (int32_t)midiNotes.size());
 		OX_DEBUG("  First note start time: %f seconds.", firstNoteStartTime);
 		OX_DEBUG("  Last note end time: %f seconds.", lastNoteEndTime);
+
+		header.key = cacheKey;
+		header.firstNoteStartTime = firstNoteStartTime;
+		header.lastNoteEndTime = lastNoteEndTime;
+		header.maxNoteDuration = maxNoteDuration;
+		if (cacheKey != 0 && !midiNotes.writeCacheFile(cachePath, header))
+			OX_WARN("Unable to write note cache: %s", cachePath.c_str());
+		buildNoteLOD();
 		return true;
     }
     catch (const std::exception& ex)
@@ -150,6 +296,119 @@ bool VPianoResources::loadMidiFile(const ostd::String& filePath)
     }
 }
 
+void VPianoResources::__parse_midi_fallback(const ostd::String& filePath, double timeOffset, MidiLoader::tResult& outResult)
+{
+	auto events = ostd::MidiParser::parseFile(filePath);
+	outResult = MidiLoader::tResult();
+	outResult.notes.reserve(events.size());
+	for (auto& note : events)
+	{
+		PackedNote packed;
+		packed.startTime = (float)(note.startTime + timeOffset);
+		packed.duration = (float)note.duration;
+		packed.pitch = (uint8_t)note.pitch;
+		packed.velocity = (uint8_t)note.velocity;
+		packed.flags = (note.first ? PackedNote::FirstNote : 0) | (note.last ? PackedNote::LastNote : 0);
+
+		if (note.first)
+			outResult.firstNoteStartTime = packed.startTime;
+		else if (note.last)
+			outResult.lastNoteEndTime = packed.startTime;
+		outResult.maxNoteDuration = std::max(outResult.maxNoteDuration, (double)packed.duration);
+		outResult.notes.push_back(packed);
+	}
+	std::sort(outResult.notes.begin(), outResult.notes.end());
+}
+
+void VPianoResources::buildNoteLOD(void)
+{
+	midiNoteLOD.clear();
+	midiNoteLODMaxDuration.clear();
+	useNoteLOD = (midiNotes.size() >= LODNoteThreshold);
+	if (!useNoteLOD) return;
+
+	auto l_mergeLevel = [](const NoteStore& src, double gap, double& outMaxDuration) -> std::vector<PackedNote> {
+		std::vector<PackedNote> dst;
+		dst.reserve(src.size() / 2);
+		std::array<std::optional<PackedNote>, 128> runs;
+		outMaxDuration = 0.0;
+		for (const auto& note : src)
+		{
+			auto& run = runs[note.pitch & 0x7F];
+			if (run && note.startTime - run->endTime() < gap)
+			{
+				run->duration = std::max(run->endTime(), note.endTime()) - run->startTime;
+				run->velocity = std::max(run->velocity, note.velocity);
+				run->flags |= note.flags;
+				continue;
+			}
+			if (run)
+			{
+				outMaxDuration = std::max(outMaxDuration, (double)run->duration);
+				dst.push_back(*run);
+			}
+			run = note;
+		}
+		for (auto& run : runs)
+		{
+			if (!run) continue;
+			outMaxDuration = std::max(outMaxDuration, (double)run->duration);
+			dst.push_back(*run);
+		}
+		std::sort(dst.begin(), dst.end());
+		return dst;
+	};
+
+	const NoteStore* prev = &midiNotes;
+	double gap = LODBaseGap_s;
+	midiNoteLOD.reserve(LODMaxLevels);
+	for (int32_t level = 0; level < LODMaxLevels; level++, gap *= 2.0)
+	{
+		double maxDuration = 0.0;
+		NoteStore merged;
+		merged.assign(l_mergeLevel(*prev, gap, maxDuration));
+		midiNoteLOD.push_back(std::move(merged));
+		midiNoteLODMaxDuration.push_back(maxDuration);
+		prev = &midiNoteLOD.back();
+		OX_DEBUG("  LOD level %d (gap %f s): %d runs.", level, gap, (int32_t)prev->size());
+	}
+}
+
+const NoteStore& VPianoResources::getNoteList(float pps, double* outMaxDuration)
+{
+	if (!useNoteLOD || midiNoteLOD.empty() || pps <= 0.0f)
+	{
+		if (outMaxDuration != nullptr) *outMaxDuration = maxNoteDuration;
+		return midiNotes;
+	}
+	// Pick the coarsest level whose merge gap still fits inside one pixel. Above 1000 pps
+	// even the finest gap is wider than a pixel, only the full list is exact enough
+	double secondsPerPixel = 1.0 / (double)pps;
+	int32_t level = (int32_t)std::floor(std::log2(secondsPerPixel / LODBaseGap_s));
+	if (level < 0)
+	{
+		if (outMaxDuration != nullptr) *outMaxDuration = maxNoteDuration;
+		return midiNotes;
+	}
+	level = std::min(level, (int32_t)midiNoteLOD.size() - 1);
+	if (outMaxDuration != nullptr) *outMaxDuration = midiNoteLODMaxDuration[level];
+	return midiNoteLOD[level];
+}
+
+double VPianoResources::getSongEndTime(void) const
+{
+	// lastNoteEndTime is the start of the last note. Notes are sorted by start time,
+	// so the one that ends last started no more than maxNoteDuration before it
+	double endTime = lastNoteEndTime;
+	for (size_t i = midiNotes.size(); i > 0; i--)
+	{
+		const auto& note = midiNotes[i - 1];
+		if (note.startTime < lastNoteEndTime - maxNoteDuration) break;
+		endTime = std::max(endTime, (double)note.endTime());
+	}
+	return endTime;
+}
+
 float VPianoResources::scanMusicStartPoint(const ostd::String& filePath, float thresholdPercent, float minDuration)
 {
 	sf::SoundBuffer buffer;
@@ -25,13 +25,28 @@
 #include <ostd/Geometry.hpp>
 #include <ostd/String.hpp>
 #include <any>
+#include <array>
 #include "Particles.hpp"
+#include "NoteStore.hpp"
+#include "MidiLoader.hpp"
+#include "RenderTargetPool.hpp"
 #include <ostd/Midi.hpp>
 #include <ostd/Json.hpp>
 
 class VirtualPiano;
+struct VirtualPianoData;
 class VPianoResources
 {
+	public: struct tGaussianKernel
+	{
+		// Tap 0 is the centre texel, every other tap is a bilinear pair sampled on both sides
+		std::array<float, 32> offsets {};
+		std::array<float, 32> weights {};
+		int32_t tapCount { 1 };
+		int32_t passes { 1 };
+		float passIntensity { 1.0f };
+	};
+
 	public:
 		VPianoResources(VirtualPiano& vpiano);
 		void loadStyleFromJson(ostd::JsonFile& style, ostd::JsonFile& particles);
@@ -39,8 +54,13 @@ class VPianoResources
 		bool loadBackgroundImage(const ostd::String& filePath);
 		bool loadParticleTexture(const ostd::String& filePath, const std::vector<ostd::Rectangle>& tiles);
 		bool loadNoteTexture(const ostd::String& filePath);
+		bool bakeGlowSlices(const VirtualPianoData& vpd);
+		void buildGaussianKernel(const VirtualPianoData& vpd, float sceneScale = 1.0f);
 		bool loadAudioFile(const ostd::String& filePath);
 		bool loadMidiFile(const ostd::String& filePath);
+		void buildNoteLOD(void);
+		const NoteStore& getNoteList(float pps, double* outMaxDuration = nullptr);
+		double getSongEndTime(void) const;
 
 		float scanMusicStartPoint(const ostd::String& filePath, float thresholdPercent = 0.02f, float minDuration = 0.05f);
 
@@ -48,6 +68,17 @@ class VPianoResources
 		inline float getAutoSoundStart(void) { return autoSoundStart; }
 		inline bool hasAudioFile(void) { return _hasAudioFile; }
 
+		// Blurred segment 'length' texels long, 't' texels from the start of its padding
+		float getGlowProfile(float t, float length) const;
+		// Where the same point is found on the glow slice row of that length
+		float getGlowSliceTexel(float t, float length) const;
+		inline float getGlowSliceRow(float length) const { return std::clamp(std::round(length), 1.0f, (float)getGlowSliceRowCount()) - 0.5f; }
+		inline int32_t getGlowSliceRowCount(void) const { return glowSliceExtent * 2; }
+
+	private:
+		bool __bake_glow_slice(void);
+		void __parse_midi_fallback(const ostd::String& filePath, double timeOffset, MidiLoader::tResult& outResult);
+
 	public:
 		VirtualPiano& vpiano;
 		sf::Music audioFile;
@@ -63,17 +94,42 @@ class VPianoResources
 		TextureRef partTexRef;
 		std::vector<TextureRef::TextureAtlasIndex> partTiles;
 
-		std::vector<ostd::MidiParser::NoteEvent> midiNotes;
+		NoteStore midiNotes;
 		double firstNoteStartTime { 0.0 };
 		double lastNoteEndTime { 0.0 };
+		double maxNoteDuration { 0.0 };
+
+		// Level-of-detail pyramid for "black MIDI" files: level N merges notes on the same
+		// key that overlap or are less than (LODBaseGap_s * 2^N) seconds apart
+		std::vector<NoteStore> midiNoteLOD;
+		std::vector<double> midiNoteLODMaxDuration;
+		bool useNoteLOD { false };
+
+		inline static constexpr size_t LODNoteThreshold { 200000 };
+		inline static constexpr double LODBaseGap_s { 0.001 };
+		inline static constexpr int32_t LODMaxLevels { 12 };
 
 		sf::Shader noteShader;
 		sf::Shader gaussianBlurShader;
 		sf::Shader kawaseUpShader;
 		sf::Shader kawaseDownShader;
-		sf::Shader thresholdShader;
-		sf::Shader flipShader;
+		sf::Shader bloomCompositeShader;
 		sf::Shader particleShader;
+		sf::Shader noteMeshShader;
+		bool noteMeshShaderLoaded { false };
+		sf::Shader analyticParticleShader;
+		bool analyticParticleShaderLoaded { false };
 		sf::Texture noteTexture;
+		tGaussianKernel gaussianKernel;
+
+		// Pre-blurred glow profiles. Row L - 1 is a segment L texels long, padded by
+		// glowSliceExtent texels on both sides. Longer segments stretch the flat middle of
+		// the last row. A note's glow is its horizontal profile times its vertical one
+		sf::Texture glowSliceTexture;
+		int32_t glowSliceExtent { 0 };
+		float glowSliceSigma { 1.0f };
+		bool glowSlicesReady { false };
+
+		RenderTargetPool renderTargets;
 
 };
@@ -40,6 +40,7 @@ bool VideoRenderer::configImageSequenceRender(const ostd::String& folderPath, co
 	if (fps != 60) return false; //TODO: allow for valid FPS values
 	if (m_vpiano.vPianoRes().lastNoteEndTime == 0.0) return false; //TODO: Error
 
+	__release_render_targets();
 	m_videoRenderState.reset();
 	m_videoRenderState.mode = VideoRenderModes::ImageSequence;
 	m_videoRenderState.resolution = resolution;
@@ -48,8 +49,7 @@ bool VideoRenderer::configImageSequenceRender(const ostd::String& folderPath, co
 	m_videoRenderState.lastNoteEndTime = m_vpiano.vPianoRes().lastNoteEndTime;
 	m_videoRenderState.totalFrames = (int32_t)std::ceil(m_videoRenderState.lastNoteEndTime * fps);
 	m_videoRenderState.oldScale = m_vpiano.vPianoData().getScale();
-	m_videoRenderState.renderTarget = sf::RenderTexture({ resolution.x, resolution.y });
-	m_videoRenderState.flippedRenderTarget = sf::RenderTexture({ resolution.x, resolution.y });
+	m_videoRenderState.renderTarget = m_vpiano.vPianoRes().renderTargets.acquire({ resolution.x, resolution.y });
 	m_videoRenderState.frameTime = 1.0 / (float)fps;
 	m_videoRenderState.renderFPS = 1;
 
@@ -73,6 +73,7 @@ bool VideoRenderer::configFFMPEGVideoRender(const ostd::String& filePath, const
 	if (fps != 60) return false; //TODO: allow for valid FPS values
 	if (m_vpiano.vPianoRes().lastNoteEndTime == 0.0) return false; //TODO: Error
 
+	__release_render_targets();
 	m_videoRenderState.reset();
 	m_videoRenderState.ffmpegProfile = profile;
 	m_videoRenderState.mode = VideoRenderModes::Video;
@@ -86,8 +87,7 @@ bool VideoRenderer::configFFMPEGVideoRender(const ostd::String& filePath, const
 	m_videoRenderState.lastNoteEndTime = m_vpiano.vPianoRes().lastNoteEndTime;
 	m_videoRenderState.totalFrames = (int32_t)std::ceil(m_videoRenderState.lastNoteEndTime * fps);
 	m_videoRenderState.oldScale = m_vpiano.vPianoData().getScale();
-	m_videoRenderState.renderTarget = sf::RenderTexture({ resolution.x, resolution.y });
-	m_videoRenderState.flippedRenderTarget = sf::RenderTexture({ resolution.x, resolution.y });
+	m_videoRenderState.renderTarget = m_vpiano.vPianoRes().renderTargets.acquire({ resolution.x, resolution.y });
 	m_videoRenderState.frameTime = 1.0 / (float)fps;
 	m_videoRenderState.renderFPS = 1;
 	m_vpiano.vPianoData().updateScale(resolution.x, resolution.y);
@@ -97,7 +97,11 @@ bool VideoRenderer::configFFMPEGVideoRender(const ostd::String& filePath, const
 	m_vpiano.stop();
 	m_videoRenderState.updateFpsTimer.startCount(ostd::eTimeUnits::Milliseconds);
 	m_videoRenderState.ffmpegPipe = __open_ffmpeg_pipe(m_videoRenderState.folderPath, resolution, fps, profile);
-	if (m_videoRenderState.ffmpegPipe == nullptr) return false;
+	if (m_videoRenderState.ffmpegPipe == nullptr)
+	{
+		__release_render_targets();
+		return false;
+	}
 
 	m_isRenderingToFile = true;
 	return true;
@@ -107,15 +111,13 @@ void VideoRenderer::renderNextOutputFrame(void)
 {
 	if (!m_isRenderingToFile) return;
 	m_vpiano.vKeyboard().updateVisualization(m_videoRenderState.currentTime);
-	m_vpiano.renderFrame(m_videoRenderState.renderTarget);
+	m_vpiano.renderFrame(*m_videoRenderState.renderTarget);
 	m_videoRenderState.framTimeTimer.startCount(ostd::eTimeUnits::Milliseconds);
-	Renderer::setRenderTarget(&m_videoRenderState.flippedRenderTarget);
-	Renderer::useShader(&m_vpiano.vPianoRes().flipShader);
-	m_vpiano.vPianoRes().flipShader.setUniform("texture", m_videoRenderState.renderTarget.getTexture());
-	Renderer::drawTexture(m_videoRenderState.renderTarget.getTexture());
-	Renderer::useShader(nullptr);
+	// display() resolves the frame and marks it as stored bottom-up, copyToImage then
+	// returns it upright, so the readback needs no flip pass of its own
+	m_videoRenderState.renderTarget->display();
 	if (m_videoRenderState.mode == VideoRenderModes::ImageSequence)
-		__save_frame_to_file(m_videoRenderState.flippedRenderTarget, m_videoRenderState.folderPath, ++m_videoRenderState.frameIndex);
+		__save_frame_to_file(*m_videoRenderState.renderTarget, m_videoRenderState.folderPath, ++m_videoRenderState.frameIndex);
 	else if (m_videoRenderState.mode == VideoRenderModes::Video)
 	{
 		__stream_frame_to_ffmpeg();
@@ -143,6 +145,7 @@ void VideoRenderer::finishOutputRender(void)
 	m_vpiano.getParentWindow().lockFullscreenStatus(false);
 	m_vpiano.getParentWindow().enableResizeable(true);
 	m_isRenderingToFile = false;
+	__release_render_targets();
 	if (m_videoRenderState.mode == VideoRenderModes::Video)
 	{
 	    if (m_videoRenderState.ffmpegPipe)
@@ -164,6 +167,13 @@ void VideoRenderer::finishOutputRender(void)
 	}
 }
 
+void VideoRenderer::__release_render_targets(void)
+{
+	// Returned to the pool, the next export at the same resolution reuses them
+	auto& pool = m_vpiano.vPianoRes().renderTargets;
+	pool.release(m_videoRenderState.renderTarget);
+}
+
 void VideoRenderer::__preallocate_file_names_for_rendering(uint32_t frameCount, const ostd::String& baseFileName, const ostd::String& basePath, ImageType imageType, const uint16_t marginFrames)
 {
 	ostd::String extension = "png";
@@ -307,9 +317,9 @@ void VideoRenderer::__stream_frame_to_ffmpeg(void)
 {
 	if (!m_isRenderingToFile) return;
 	if (m_videoRenderState.mode != VideoRenderModes::Video) return;
-	sf::Image frame = m_videoRenderState.flippedRenderTarget.getTexture().copyToImage();
+	sf::Image frame = m_videoRenderState.renderTarget->getTexture().copyToImage();
     const uint8_t* pixels = frame.getPixelsPtr();
-    std::size_t dataSize = m_videoRenderState.flippedRenderTarget.getSize().x * m_videoRenderState.flippedRenderTarget.getSize().y * 4;
+    std::size_t dataSize = m_videoRenderState.renderTarget->getSize().x * m_videoRenderState.renderTarget->getSize().y * 4;
     if (!m_videoRenderState.ffmpeg_child.running())
     {
         OX_ERROR("FFmpeg not running");
@@ -38,6 +38,7 @@ class VideoRenderer
 		void __preallocate_file_names_for_rendering(uint32_t frameCount, const ostd::String& baseFileName, const ostd::String& basePath, ImageType imageType, const uint16_t marginFrames = 200);
 		FILE* __open_ffmpeg_pipe(const ostd::String& filePath, const ostd::UI16Point& resolution, uint8_t fps, const FFMPEG::tProfile& profile);
 		void __save_frame_to_file(const sf::RenderTexture& rt, const ostd::String& basePath, int frameIndex);
+		void __release_render_targets(void);
 		void __stream_frame_to_ffmpeg(void);
 
 	public:
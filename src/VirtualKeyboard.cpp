@@ -22,6 +22,9 @@
 #include "VirtualPiano.hpp"
 #include "Renderer.hpp"
 #include "Window.hpp"
+#include "ThreadPool.hpp"
+#include "RoundedRectangleShape.hpp"
+#include <limits>
 
 
 VirtualKeyboard::VirtualKeyboard(VirtualPiano& vpiano) : m_vpiano(vpiano)
@@ -44,6 +47,7 @@ void VirtualKeyboard::loadFromStyleJSON(ostd::JsonFile& styleJson)
 
 		uint32_t tileIndex = styleJson.get_int("particles.tileIndex");
 		pk.particles = ParticleFactory::basicFireEmitter({ &m_vpiano.vPianoRes().partTexRef, tileIndex }, { 0, 0 }, 0);
+		pk.particles.setRandomSeed((uint64_t)midiNote);
 		bool useTileArray = styleJson.get_bool("emitter.useTileArray");
 		pk.particles.useTileArray(useTileArray);
 		pk.particles.setMaxParticleCount(styleJson.get_int("emitter.maxParticles"));
@@ -93,42 +97,40 @@ void VirtualKeyboard::loadFromStyleJSON(ostd::JsonFile& styleJson)
 
 		m_pianoKeys.push_back(pk);
 	}
+	m_analyticParticles.destroy();
+	m_analyticParticlesEnabled = styleJson.get_bool("emitter.analytic");
+	if (m_analyticParticlesEnabled && m_pianoKeys.size() > 0)
+		m_analyticParticles.create(m_pianoKeys[0].particles, m_pianoKeys.size() * m_pianoKeys[0].particles.getMaxParticleCount());
 }
 
 void VirtualKeyboard::calculateFallingNotes(double currentTime)
 {
-	auto l_calcPressedVelocity = [this](int32_t midiVelocity) -> ostd::Vec2 {
-		return { 0.0f, -((float)(midiVelocity / 128.0f)) * (float)m_vpiano.vPianoData().pressedVelocityMultiplier };
+	auto& vpd = m_vpiano.vPianoData();
+	auto l_calcPressedVelocity = [&vpd](int32_t midiVelocity) -> ostd::Vec2 {
+		return { 0.0f, -((float)(midiVelocity / 128.0f)) * (float)vpd.pressedVelocityMultiplier };
 	};
 
-	m_fallingNoteGfx_w.clear();
-	m_fallingNoteGfx_b.clear();
-	for (auto& note : m_activeFallingNotes)
-	{
-		auto noteInfo = ostd::MidiParser::getNoteInfo(note.pitch);
-		if (noteInfo.isBlackKey()) continue;
-
-		double h = note.duration * m_vpiano.vPianoData().pps();
-		double totalTravelTime = m_vpiano.vPianoData().fallingTime_s + note.duration;
-		double elapsedSinceSpawn = (currentTime - (note.startTime - m_vpiano.vPianoData().fallingTime_s));
-		double progress = elapsedSinceSpawn / totalTravelTime;
-		progress = std::clamp(progress, 0.0, 1.0);
-		double y = -h + static_cast<double>(progress) * (m_vpiano.vPianoData().vpy() + h);
-		double x = m_vpiano.vPianoData().keyOffsets()[noteInfo.keyIndex] + (m_vpiano.vPianoData().whiteKey_shrink() / 2.0f);
-
-		if (y >= m_vpiano.vPianoData().vpy())
+	// The active set is heap ordered, so a finished note may be visited after a newer note
+	// on the same key. A press always wins over a release within one frame
+	std::array<bool, 88> pressedThisFrame {};
+	auto l_updateKeyState = [&](const PackedNote& note, int32_t keyIndex, float y, float h) {
+		if (y >= vpd.vpy())
 		{
-			auto& key = m_pianoKeys[noteInfo.keyIndex];
-			key.pressed = false;
-			key.pressedForce = { 0.0f, 0.0f };
+			auto& key = m_pianoKeys[keyIndex];
+			if (!pressedThisFrame[keyIndex])
+			{
+				key.pressed = false;
+				key.pressedForce = { 0.0f, 0.0f };
+			}
 			NoteEventData ned(key);
 			ned.eventType = NoteEventData::eEventType::NoteOFF;
 			ned.note = note;
 			ostd::SignalHandler::emitSignal(SignalListener::NoteOffSignal, ostd::tSignalPriority::RealTime, ned);
 		}
-		else if (y + h >= m_vpiano.vPianoData().vpy())
+		else if (y + h >= vpd.vpy())
 		{
-			auto& key = m_pianoKeys[noteInfo.keyIndex];
+			auto& key = m_pianoKeys[keyIndex];
+			pressedThisFrame[keyIndex] = true;
 			key.pressed = true;
 			key.pressedForce = l_calcPressedVelocity(note.velocity);
 			NoteEventData ned(key);
@@ -141,95 +143,82 @@ void VirtualKeyboard::calculateFallingNotes(double currentTime)
 				m_vpiano.m_firstNotePlayed = true;
 			}
 		}
-		ostd::Color noteColor = m_vpiano.vPianoData().fallingWhiteNoteColor;
-		ostd::Color outlineColor = m_vpiano.vPianoData().fallingWhiteNoteOutlineColor;
-		ostd::Color glowColor = m_vpiano.vPianoData().fallingWhiteNoteGlowColor;
-		if (m_vpiano.vPianoData().usePerNoteColors)
-		{
-			noteColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave];
-			outlineColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave + 12];
-			glowColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave + 24];
-		}
-		m_fallingNoteGfx_w.push_back(FallingNoteGraphicsData {
-			{ static_cast<float>(x), static_cast<float>(y), m_vpiano.vPianoData().whiteKey_w() - m_vpiano.vPianoData().whiteKey_shrink(), static_cast<float>(h) },
-			noteColor,
-			outlineColor,
-			glowColor,
-			&m_vpiano.vPianoRes().noteTexture,
-			-m_vpiano.vPianoData().fallingWhiteNoteOutlineWidth,
-			m_vpiano.vPianoData().fallingWhiteNoteBorderRadius
-		});
-	}
+	};
 
-	for (auto& note : m_activeFallingNotes)
+	// With the static mesh the GPU places the notes, only key state is derived here. Notes
+	// move at a constant pps, matching noteMesh.vert, so keys still go down as notes land
+	if (__use_note_mesh())
 	{
-		auto noteInfo = ostd::MidiParser::getNoteInfo(note.pitch);
-		if (noteInfo.isWhiteKey()) continue;
-
-		double h = note.duration * m_vpiano.vPianoData().pps();
-		double totalTravelTime = m_vpiano.vPianoData().fallingTime_s + note.duration;
-		double elapsedSinceSpawn = (currentTime - (note.startTime - m_vpiano.vPianoData().fallingTime_s));
-		double progress = elapsedSinceSpawn / totalTravelTime;
-		progress = std::clamp(progress, 0.0, 1.0);
-		float y = -h + static_cast<float>(progress) * (m_vpiano.vPianoData().vpy() + h);
-		float x = m_vpiano.vPianoData().keyOffsets()[noteInfo.keyIndex] + (m_vpiano.vPianoData().blackKey_shrink() / 2.0f);
-
-		if (y >= m_vpiano.vPianoData().vpy())
+		m_fallingNoteGfx_w.clear();
+		m_fallingNoteGfx_b.clear();
+		for (auto& note : m_activeFallingNotes)
 		{
-			auto& key = m_pianoKeys[noteInfo.keyIndex];
-			key.pressed = false;
-			key.pressedForce = { 0.0f, 0.0f };
-			NoteEventData ned(key);
-			ned.eventType = NoteEventData::eEventType::NoteOFF;
-			ned.note = note;
-			ostd::SignalHandler::emitSignal(SignalListener::NoteOffSignal, ostd::tSignalPriority::RealTime, ned);
+			auto noteInfo = ostd::MidiParser::getNoteInfo(note.pitch);
+			float h = note.duration * vpd.pps();
+			float y = vpd.vpy() - (float)((note.endTime() - currentTime) * vpd.pps());
+			l_updateKeyState(note, noteInfo.keyIndex, y, h);
 		}
-		else if (y + h >= m_vpiano.vPianoData().vpy())
+		m_noteMesh.updateVisiblePages(currentTime, vpd.vpy() / vpd.pps(), vpd.whiteKey_h() / vpd.pps() + 0.5);
+		return;
+	}
+
+	// Notes are placed in parallel, each into its own slot. Key state and signals depend
+	// on visiting order, so only those stay serial, whites first as they are drawn
+	m_noteLayout.resize(m_activeFallingNotes.size());
+	ThreadPool::shared().parallelFor(m_activeFallingNotes.size(), GeometryChunkSize, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
 		{
-			auto& key = m_pianoKeys[noteInfo.keyIndex];
-			key.pressed = true;
-			key.pressedForce = l_calcPressedVelocity(note.velocity);
-			NoteEventData ned(key);
-			ned.eventType = NoteEventData::eEventType::NoteON;
-			ned.note = note;
-			ostd::SignalHandler::emitSignal(SignalListener::NoteOnSignal, ostd::tSignalPriority::RealTime, ned);
-			if (!m_vpiano.m_firstNotePlayed)
-			{
-				ostd::SignalHandler::emitSignal(SignalListener::MidiStartSignal, ostd::tSignalPriority::RealTime, ned);
-				m_vpiano.m_firstNotePlayed = true;
-			}
+			const auto& note = m_activeFallingNotes[i];
+			auto noteInfo = ostd::MidiParser::getNoteInfo(note.pitch);
+			double h = note.duration * vpd.pps();
+			double totalTravelTime = vpd.fallingTime_s + note.duration;
+			double elapsedSinceSpawn = (currentTime - (note.startTime - vpd.fallingTime_s));
+			double progress = elapsedSinceSpawn / totalTravelTime;
+			progress = std::clamp(progress, 0.0, 1.0);
+			double y = -h + progress * (vpd.vpy() + h);
+			m_noteLayout[i] = { static_cast<float>(y), static_cast<float>(h), noteInfo.keyIndex, noteInfo.noteInOctave, noteInfo.isBlackKey() };
 		}
-		ostd::Color noteColor = m_vpiano.vPianoData().fallingBlackNoteColor;
-		ostd::Color outlineColor = m_vpiano.vPianoData().fallingBlackNoteOutlineColor;
-		ostd::Color glowColor = m_vpiano.vPianoData().fallingBlackNoteGlowColor;
-		if (m_vpiano.vPianoData().usePerNoteColors)
+	});
+
+	m_noteLayout_w.clear();
+	m_noteLayout_b.clear();
+	for (bool black : { false, true })
+	{
+		auto& layoutList = (black ? m_noteLayout_b : m_noteLayout_w);
+		for (size_t i = 0; i < m_noteLayout.size(); i++)
 		{
-			noteColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave];
-			outlineColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave + 12];
-			glowColor = m_vpiano.vPianoData().perNoteColors[noteInfo.noteInOctave + 24];
+			const auto& layout = m_noteLayout[i];
+			if (layout.black != black) continue;
+			l_updateKeyState(m_activeFallingNotes[i], layout.keyIndex, layout.y, layout.h);
+			layoutList.push_back(layout);
 		}
-		m_fallingNoteGfx_b.push_back(FallingNoteGraphicsData {
-			{ static_cast<float>(x), static_cast<float>(y), m_vpiano.vPianoData().blackKey_w() - m_vpiano.vPianoData().blackKey_shrink(), static_cast<float>(h) },
-			noteColor,
-			outlineColor,
-			glowColor,
-			&m_vpiano.vPianoRes().noteTexture,
-			-m_vpiano.vPianoData().fallingBlackNoteOutlineWidth,
-			m_vpiano.vPianoData().fallingBlackNoteBorderRadius
-		});
 	}
+
+	__build_note_graphics(m_noteLayout_w, m_fallingNoteGfx_w, false);
+	__build_note_graphics(m_noteLayout_b, m_fallingNoteGfx_b, true);
 }
 
 void VirtualKeyboard::updateVisualization(double currentTime)
 {
+	// In LOD mode the note list depends on the current zoom, so switching lists
+	// requires rebuilding the active set from the new timeline
+	double maxDuration = 0.0;
+	auto& noteList = m_vpiano.vPianoRes().getNoteList(m_vpiano.vPianoData().pps(), &maxDuration);
+	if (&noteList != m_noteList)
+		__rebase_note_list(noteList, maxDuration, currentTime);
+	m_visualTime = currentTime;
+	if (m_vpiano.vPianoData().useStaticNoteMesh && m_noteMesh.getSource() != &noteList)
+		m_noteMesh.build(noteList, m_vpiano.vPianoData());
+
 	// Remove notes that have ended
-	while (!m_activeFallingNotes.empty() && currentTime > (m_activeFallingNotes.front().endTime + 0.05))
+	while (!m_activeFallingNotes.empty() && currentTime > (m_activeFallingNotes.front().endTime() + 0.05))
 	{
-		auto note = m_activeFallingNotes.front();
+		std::pop_heap(m_activeFallingNotes.begin(), m_activeFallingNotes.end(), __ends_later);
+		auto note = m_activeFallingNotes.back();
 		auto info = ostd::MidiParser::getNoteInfo(note.pitch);
 		m_pianoKeys[info.keyIndex].pressed = false;
 		m_pianoKeys[info.keyIndex].pressedForce = { 0.0f, 0.0f };
-		if (note.last)
+		if (note.isLast())
 		{
 			auto& key = m_pianoKeys[info.keyIndex];
 			NoteEventData ned(key);
@@ -237,103 +226,145 @@ void VirtualKeyboard::updateVisualization(double currentTime)
 			ned.note = note;
 			ostd::SignalHandler::emitSignal(SignalListener::MidiEndSignal, ostd::tSignalPriority::RealTime, ned);
 		}
-		m_activeFallingNotes.pop_front();
+		m_activeFallingNotes.pop_back();
 	}
 
 	// Add new notes that are starting now
-	while (m_nextFallingNoteIndex < m_vpiano.vPianoRes().midiNotes.size() && currentTime >= m_vpiano.vPianoRes().midiNotes[m_nextFallingNoteIndex].startTime - m_vpiano.vPianoData().fallingTime_s)
+	while (m_nextFallingNoteIndex < noteList.size() && currentTime >= noteList[m_nextFallingNoteIndex].startTime - m_vpiano.vPianoData().fallingTime_s)
 	{
-		// auto info = ostd::MidiParser::getNoteInfo(m_midiNotes[m_nextFallingNoteIndex].pitch);
-		m_activeFallingNotes.push_back(m_vpiano.vPianoRes().midiNotes[m_nextFallingNoteIndex]);
+		m_activeFallingNotes.push_back(noteList[m_nextFallingNoteIndex]);
+		std::push_heap(m_activeFallingNotes.begin(), m_activeFallingNotes.end(), __ends_later);
 		++m_nextFallingNoteIndex;
 	}
 	calculateFallingNotes(currentTime);
 }
 
+void VirtualKeyboard::applyLiveEvent(const tLiveMidiEvent& evt, uint16_t particleBurst)
+{
+	auto info = ostd::MidiParser::getNoteInfo(evt.pitch);
+	auto& key = m_pianoKeys[info.keyIndex];
+	double time = evt.timestamp_ns * 1e-9;
+	PackedNote note;
+	note.pitch = evt.pitch;
+	note.velocity = evt.velocity;
+	note.startTime = (float)time;
+	NoteEventData ned(key);
+	ned.note = note;
+	if (evt.noteOn)
+	{
+		m_liveNotes.push_back({ time, time, evt.pitch, evt.velocity, true });
+		key.pressed = true;
+		key.pressedForce = { 0.0f, -((float)(evt.velocity / 128.0f)) * (float)m_vpiano.vPianoData().pressedVelocityMultiplier };
+		// Emit right away instead of waiting for the next fixed update, so the first
+		// particles show up in the same frame as the key
+		if (useAnalyticParticles())
+			m_analyticParticles.spawn(key.particles, key.pressedForce, particleBurst);
+		else
+			key.particles.emit(particleBurst);
+		ned.eventType = NoteEventData::eEventType::NoteON;
+		ostd::SignalHandler::emitSignal(SignalListener::NoteOnSignal, ostd::tSignalPriority::RealTime, ned);
+		return;
+	}
+	bool stillHeld = false;
+	bool released = false;
+	for (auto& liveNote : m_liveNotes)
+	{
+		if (!liveNote.held || liveNote.pitch != evt.pitch) continue;
+		if (!released)
+		{
+			liveNote.held = false;
+			liveNote.endTime = time;
+			released = true;
+		}
+		else
+			stillHeld = true;
+	}
+	if (stillHeld) return;
+	key.pressed = false;
+	key.pressedForce = { 0.0f, 0.0f };
+	ned.eventType = NoteEventData::eEventType::NoteOFF;
+	ostd::SignalHandler::emitSignal(SignalListener::NoteOffSignal, ostd::tSignalPriority::RealTime, ned);
+}
+
+void VirtualKeyboard::updateLiveNotes(double currentTime)
+{
+	// Live notes grow upwards out of the keyboard while held and keep rising once
+	// released, at the same speed falling notes travel at
+	auto& vpd = m_vpiano.vPianoData();
+	float pps = vpd.pps();
+	float vpy = vpd.vpy();
+	std::erase_if(m_liveNotes, [&](const tLiveNote& note) {
+		return !note.held && vpy - (currentTime - note.endTime) * pps < 0.0;
+	});
+	m_fallingNoteGfx_w.clear();
+	m_fallingNoteGfx_b.clear();
+	for (int32_t pass = 0; pass < 2; pass++)
+	{
+		for (const auto& note : m_liveNotes)
+		{
+			auto noteInfo = ostd::MidiParser::getNoteInfo(note.pitch);
+			if (noteInfo.isBlackKey() != (pass == 1)) continue;
+			float top = vpy - (float)((currentTime - note.startTime) * pps);
+			float bottom = (note.held ? vpy : vpy - (float)((currentTime - note.endTime) * pps));
+			__push_note_graphics(noteInfo, top, std::max(bottom - top, 1.0f));
+		}
+	}
+}
+
+void VirtualKeyboard::clearLiveNotes(void)
+{
+	m_liveNotes.clear();
+	m_fallingNoteGfx_w.clear();
+	m_fallingNoteGfx_b.clear();
+	for (auto& pk : m_pianoKeys)
+	{
+		pk.pressed = false;
+		pk.pressedForce = { 0.0f, 0.0f };
+	}
+}
+
 void VirtualKeyboard::renderKeyboard(std::optional<std::reference_wrapper<sf::RenderTarget>> target)
 {
 	sf::RenderTarget*  __target = nullptr;
 	if (target)
 		__target = &target->get();
 	Renderer::setRenderTarget(__target);
+	if (useAnalyticParticles())
+	{
+		auto& tex = std::any_cast<sf::Texture&>(m_vpiano.vPianoRes().partTex);
+		auto& shader = m_vpiano.vPianoRes().analyticParticleShader;
+		shader.setUniform("u_texture", tex);
+		m_analyticParticles.draw(shader);
+	}
+	// Every emitter shares the texture and shader, so all particles go out in one draw call
+	m_particleBatch.clear();
 	for (auto& pk : m_pianoKeys)
+		m_particleBatch.add(pk.particles);
+	m_particleBatch.upload();
+	if (m_particleBatch.getVertexCount() > 0)
 	{
 		auto& tex = std::any_cast<sf::Texture&>(m_vpiano.vPianoRes().partTex);
 		Renderer::useShader(&m_vpiano.vPianoRes().particleShader);
 		m_vpiano.vPianoRes().particleShader.setUniform("u_texture", tex);
 		Renderer::useTexture(&tex);
-		Renderer::drawParticleSysten(pk.particles);
+		Renderer::drawParticleBatch(m_particleBatch);
 	}
 	Renderer::useShader(nullptr);
 	Renderer::useTexture(nullptr);
-	auto& vpd = m_vpiano.vPianoData();
-	int whiteKeyCount = 0;
-	for (int midiNote = 21; midiNote <= 108; ++midiNote)
-	{
-		int noteInOctave = midiNote % 12;
-		if (ostd::MidiParser::NoteInfo::isWhiteKey(noteInOctave)) // Draw white key
-		{
-			auto info = ostd::MidiParser::getNoteInfo(midiNote);
-			PianoKey& pk = m_pianoKeys[info.keyIndex];
-			ostd::Color keyColor = (pk.pressed ? vpd.whiteKeyPressedColor : vpd.whiteKeyColor);
-			float x = vpd.vpx() + (whiteKeyCount * vpd.whiteKey_w());
-			float y = vpd.vpy();
-			pk.particles.setEmissionRect({ x + (vpd.whiteKey_w() / 2.0f) - (vpd.whiteKey_w() / 8.0f), y - 2.0f, vpd.whiteKey_w() / 4.0f, 2.0f });
-			Renderer::outlineRect({ x, y, vpd.whiteKey_w(), vpd.whiteKey_h() }, keyColor, vpd.whiteKeySplitColor, 1 );
-			whiteKeyCount++;
-		}
-	}
-	Renderer::outlineRect({ vpd.vpx(), vpd.vpy() - 2, (float)m_vpiano.getParentWindow().getWindowWidth(), 2 }, vpd.pianoLineColor1, vpd.pianoLineColor1, 1);
-	Renderer::outlineRect({ vpd.vpx(), vpd.vpy(), (float)m_vpiano.getParentWindow().getWindowWidth(), 5 }, vpd.pianoLineColor2, vpd.pianoLineColor2, 1);
-	whiteKeyCount = 0;
-	for (int midiNote = 21; midiNote <= 108; ++midiNote)
-	{
-		int noteInOctave = midiNote % 12;
-		if (ostd::MidiParser::NoteInfo::isWhiteKey(noteInOctave))
-		{
-			whiteKeyCount++;
-		}
-		else // Draw black key
-		{
-			auto info = ostd::MidiParser::getNoteInfo(midiNote);
-			PianoKey& pk = m_pianoKeys[info.keyIndex];
-			ostd::Color keyColor = (pk.pressed ? vpd.blackKeyPressedColor : vpd.blackKeyColor);
-			float x = vpd.vpx() + ((whiteKeyCount - 1) * vpd.whiteKey_w() + (vpd.whiteKey_w() - vpd.blackKey_w() / 2.0f)) - vpd.blackKey_offset();
-			float y = vpd.vpy();
-			pk.particles.setEmissionRect({ x + (vpd.blackKey_w() / 2.0f) - (vpd.blackKey_w() / 8.0f), y - 2.0f, vpd.blackKey_w() / 4.0f, 2.0f });
-			Renderer::outlineRoundedRect({ x, y, vpd.blackKey_w(), vpd.blackKey_h() }, keyColor, vpd.blackKeySplitColor, { 0, 0, 5, 5 }, 1);
-		}
-	}
+	__update_emission_rects();
 
+	// The layer is built in view space, which differs from the target size while the
+	// scene renders at a reduced resolution
+	sf::Vector2u targetSize = m_vpiano.getParentWindow().sfWindow().getSize();
+	if (__target != nullptr)
+		targetSize = { (uint32_t)std::round(__target->getView().getSize().x), (uint32_t)std::round(__target->getView().getSize().y) };
+	auto& layer = __get_keyboard_layer(targetSize);
+	Renderer::setRenderTarget(__target);
+	Renderer::drawTexture(layer.texture.getTexture(), { 0.0f, layer.originY });
 
-	// DEBUG
-	// whiteKeyCount = 0;
-	// for (int midiNote = 21; midiNote <= 108; ++midiNote)
-	// {
-	// 	int noteInOctave = midiNote % 12;
-	// 	if (ostd::MidiParser::NoteInfo::isWhiteKey(noteInOctave))
-	// 	{
-	// 		float x = vpd.vpx() + (whiteKeyCount * vpd.whiteKey_w());
-	// 		float y = vpd.vpy();
-	// 		Renderer::fillRect({ x + (vpd.whiteKey_w() / 2.0f) - (vpd.whiteKey_w() / 8.0f), y - 2.0f, vpd.whiteKey_w() / 4.0f, 2.0f }, { 255, 255, 0, 100 });
-	// 		whiteKeyCount++;
-	// 	}
-	// }
-	// whiteKeyCount = 0;
-	// for (int midiNote = 21; midiNote <= 108; ++midiNote)
-	// {
-	// 	int noteInOctave = midiNote % 12;
-	// 	if (ostd::MidiParser::NoteInfo::isWhiteKey(noteInOctave))
-	// 	{
-	// 		whiteKeyCount++;
-	// 	}
-	// 	else // Draw black key
-	// 	{
-	// 		float x = vpd.vpx() + ((whiteKeyCount - 1) * vpd.whiteKey_w() + (vpd.whiteKey_w() - vpd.blackKey_w() / 2.0f)) - vpd.blackKey_offset();
-	// 		float y = vpd.vpy();
-	// 		Renderer::fillRect({ x + (vpd.blackKey_w() / 2.0f) - (vpd.blackKey_w() / 8.0f), y - 2.0f, vpd.blackKey_w() / 4.0f, 2.0f }, { 0, 0, 255, 100 });
-	// 	}
-	// }
+	// Only pressed keys are drawn on top of the cached layer, in a single draw call
+	__update_key_overlay(layer);
+	Renderer::drawVertexArray(layer.keyOverlay);
 }
 
 void VirtualKeyboard::renderFallingNotes(std::optional<std::reference_wrapper<sf::RenderTarget>> target)
@@ -342,6 +373,11 @@ void VirtualKeyboard::renderFallingNotes(std::optional<std::reference_wrapper<sf
 	if (target)
 		__target = &target->get();
 	Renderer::setRenderTarget(__target);
+	if (__use_note_mesh())
+	{
+		__render_note_mesh(eNoteMeshPass::Notes);
+		return;
+	}
 	__render_falling_notes(m_fallingNoteGfx_w);
 	__render_falling_notes(m_fallingNoteGfx_b);
 }
@@ -352,6 +388,17 @@ void VirtualKeyboard::renderFallingNotesGlow(std::optional<std::reference_wrappe
 	if (target)
 		__target = &target->get();
 	Renderer::setRenderTarget(__target);
+	if (__use_note_mesh())
+	{
+		__render_note_mesh(__use_glow_slices() ? eNoteMeshPass::GlowSlices : eNoteMeshPass::Glow);
+		return;
+	}
+	if (__use_glow_slices())
+	{
+		__render_glow_slices(m_fallingNoteGfx_b, true);
+		__render_glow_slices(m_fallingNoteGfx_w, false);
+		return;
+	}
 	__render_falling_notes_glow(m_fallingNoteGfx_b);
 	__render_falling_notes_glow(m_fallingNoteGfx_w);
 }
@@ -362,10 +409,565 @@ void VirtualKeyboard::renderHollowNoteNegative(std::optional<std::reference_wrap
 	if (target)
 		__target = &target->get();
 	Renderer::setRenderTarget(__target);
+	if (__use_note_mesh())
+	{
+		__render_note_mesh(eNoteMeshPass::HollowNegative);
+		return;
+	}
 	__render_hollow_note_negatives(m_fallingNoteGfx_b);
 	__render_hollow_note_negatives(m_fallingNoteGfx_w);
 }
 
+bool VirtualKeyboard::getGlowRegion(ostd::Rectangle& outRegion)
+{
+	// Bounds of everything the glow pass would draw this frame, false if nothing would be
+	auto& vpd = m_vpiano.vPianoData();
+	float left = 0.0f, top = 0.0f, right = 0.0f, bottom = 0.0f;
+	if (__use_note_mesh())
+	{
+		int32_t lowKey = 0, highKey = 0;
+		if (!m_noteMesh.getVisibleKeyRange(lowKey, highKey)) return false;
+		auto& offsets = vpd.keyOffsets();
+		left = offsets[lowKey];
+		right = offsets[highKey] + vpd.whiteKey_w();
+		bottom = vpd.vpy() + vpd.whiteKey_h();
+	}
+	else
+	{
+		if (m_fallingNoteGfx_w.empty() && m_fallingNoteGfx_b.empty()) return false;
+		left = top = std::numeric_limits<float>::max();
+		right = bottom = std::numeric_limits<float>::lowest();
+		for (const auto* list : { &m_fallingNoteGfx_w, &m_fallingNoteGfx_b })
+		{
+			for (const auto& note : *list)
+			{
+				left = std::min(left, note.rect.x);
+				top = std::min(top, note.rect.y);
+				right = std::max(right, note.rect.x + note.rect.w);
+				bottom = std::max(bottom, note.rect.y + note.rect.h);
+			}
+		}
+	}
+	auto margins = vpd.getGlowMargins();
+	outRegion = { left - margins.x, top - margins.y, (right - left) + margins.x + margins.w, (bottom - top) + margins.y + margins.h };
+	return true;
+}
+
+bool VirtualKeyboard::useAnalyticParticles(void)
+{
+	return m_analyticParticlesEnabled && m_analyticParticles.isCreated() && m_vpiano.vPianoRes().analyticParticleShaderLoaded
+		&& sf::VertexBuffer::isAvailable();
+}
+
+bool VirtualKeyboard::__use_note_mesh(void)
+{
+	// Live notes have no end time yet, so they keep going through the per-frame path
+	return m_vpiano.vPianoData().useStaticNoteMesh && m_vpiano.vPianoRes().noteMeshShaderLoaded && m_noteMesh.isBuilt()
+		&& !m_vpiano.isLiveInputActive() && sf::VertexBuffer::isAvailable();
+}
+
+void VirtualKeyboard::__render_note_mesh(eNoteMeshPass pass)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	auto& res = m_vpiano.vPianoRes();
+	auto& shader = res.noteMeshShader;
+	sf::Vector2u texSize = res.noteTexture.getSize();
+	shader.setUniform("u_time", (float)m_visualTime);
+	shader.setUniform("u_pps", vpd.pps());
+	shader.setUniform("u_vpy", vpd.vpy());
+	shader.setUniform("u_scaleX", vpd.getScale().x);
+	shader.setUniform("u_mode", (int32_t)pass);
+	shader.setUniform("u_texture", res.noteTexture);
+	shader.setUniform("u_texRect", sf::Glsl::Vec4(vpd.texCoordsPos.x / std::max(texSize.x, 1u), vpd.texCoordsPos.y / std::max(texSize.y, 1u), vpd.texCoordsScale.x, vpd.texCoordsScale.y));
+
+	ostd::Rectangle margins = { 0.0f, 0.0f, 0.0f, 0.0f };
+	if (pass == eNoteMeshPass::Glow || pass == eNoteMeshPass::GlowSlices)
+		margins = vpd.getGlowMargins();
+	else if (pass == eNoteMeshPass::HollowNegative)
+		margins = { -HollowNegativeInset, -HollowNegativeInset, -HollowNegativeInset, -HollowNegativeInset };
+	if (pass == eNoteMeshPass::GlowSlices)
+	{
+		float extent = (float)res.glowSliceExtent;
+		margins = { margins.x + extent, margins.y + extent, margins.w + extent, margins.h + extent };
+	}
+	shader.setUniform("u_margins", sf::Glsl::Vec4(margins.x, margins.y, margins.w, margins.h));
+
+	// The blur is linear, so the glow of separate notes adds up. Glow shapes that overlap
+	// count twice where they overlap, the blurred union would count them once
+	sf::RenderStates sliceStates;
+	sliceStates.shader = &shader;
+	sliceStates.blendMode = sf::BlendMode(sf::BlendMode::Factor::One, sf::BlendMode::Factor::One, sf::BlendMode::Equation::Add);
+	Renderer::useTexture(nullptr);
+	Renderer::useShader(&shader);
+	if (pass == eNoteMeshPass::GlowSlices)
+		Renderer::useRenderStates(&sliceStates);
+	// Same order as the per-frame path: notes white first, glow and negatives black first
+	bool blackFirst = (pass != eNoteMeshPass::Notes);
+	for (int32_t i = 0; i < 2; i++)
+	{
+		bool black = (blackFirst ? i == 0 : i == 1);
+		std::array<sf::Glsl::Vec4, 12> fillColors;
+		std::array<sf::Glsl::Vec4, 12> outlineColors;
+		std::array<sf::Glsl::Vec4, 12> glowColors;
+		for (int32_t n = 0; n < 12; n++)
+		{
+			fillColors[n] = color_to_glsl((vpd.usePerNoteColors ? vpd.perNoteColors[n] : (black ? vpd.fallingBlackNoteColor : vpd.fallingWhiteNoteColor)));
+			outlineColors[n] = color_to_glsl((vpd.usePerNoteColors ? vpd.perNoteColors[n + 12] : (black ? vpd.fallingBlackNoteOutlineColor : vpd.fallingWhiteNoteOutlineColor)));
+			ostd::Color glowColor = (vpd.usePerNoteColors ? vpd.perNoteColors[n + 24] : (black ? vpd.fallingBlackNoteGlowColor : vpd.fallingWhiteNoteGlowColor));
+			glowColors[n] = color_to_glsl((pass == eNoteMeshPass::GlowSlices ? vpd.blur.prepareSliceGlowColor(glowColor) : glowColor));
+		}
+		if (pass == eNoteMeshPass::GlowSlices)
+		{
+			shader.setUniform("u_glowSlice", res.glowSliceTexture);
+			shader.setUniform("u_sliceSize", sf::Glsl::Vec2((float)res.glowSliceTexture.getSize().x, (float)res.glowSliceTexture.getSize().y));
+			shader.setUniform("u_sliceExtent", (float)res.glowSliceExtent);
+		}
+		shader.setUniformArray("u_fillColors", fillColors.data(), fillColors.size());
+		shader.setUniformArray("u_outlineColors", outlineColors.data(), outlineColors.size());
+		shader.setUniformArray("u_glowColors", glowColors.data(), glowColors.size());
+		shader.setUniform("u_noteWidth", (black ? vpd.blackKey_w() - vpd.blackKey_shrink() : vpd.whiteKey_w() - vpd.whiteKey_shrink()));
+		shader.setUniform("u_outlineWidth", (float)(black ? vpd.fallingBlackNoteOutlineWidth : vpd.fallingWhiteNoteOutlineWidth));
+		float cornerRadius = (black ? vpd.fallingBlackNoteBorderRadius : vpd.fallingWhiteNoteBorderRadius);
+		shader.setUniform("u_cornerRadius", (pass == eNoteMeshPass::HollowNegative ? HollowNegativeCornerRadius : cornerRadius));
+		m_noteMesh.draw(black);
+	}
+	Renderer::useRenderStates(nullptr);
+	Renderer::useShader(nullptr);
+}
+
+bool VirtualKeyboard::__use_glow_slices(void)
+{
+	return m_vpiano.vPianoData().blur.useGlowSlices && m_vpiano.vPianoRes().glowSlicesReady;
+}
+
+void VirtualKeyboard::__render_glow_slices(const std::vector<FallingNoteGraphicsData>& noteList, bool black)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	auto& res = m_vpiano.vPianoRes();
+	float extent = (float)res.glowSliceExtent;
+	float edge = extent * 2.0f;
+	float strip = std::max(res.glowSliceSigma * 0.5f, 1.0f);
+	auto margins = vpd.getGlowMargins();
+
+	// The texture carries the horizontal profile, the vertex colours the vertical one.
+	// Columns break where the texel mapping bends. Rows are half a sigma apart through
+	// both falloffs, the profile is within 1% of linear over that distance
+	auto& vertices = m_glowSliceVertices[black ? 1 : 0];
+	vertices.setPrimitiveType(sf::PrimitiveType::Triangles);
+	vertices.clear();
+	std::vector<float> columns, rows;
+	for (auto& note : noteList)
+	{
+		float boxW = note.rect.w + margins.x + margins.w;
+		float boxH = note.rect.h + margins.y + margins.h;
+		float x = note.rect.x - margins.x - extent;
+		float y = note.rect.y - margins.y - extent;
+		float w = boxW + edge;
+		float h = boxH + edge;
+
+		columns.assign({ 0.0f, w });
+		if (boxW > (float)res.getGlowSliceRowCount())
+			columns.assign({ 0.0f, edge, w - edge, w });
+		rows.clear();
+		auto l_addRows = [&rows, strip](float from, float to) {
+			int32_t count = std::max((int32_t)std::ceil((to - from) / strip), 1);
+			for (int32_t i = 0; i < count; i++)
+				rows.push_back(from + ((to - from) * i / count));
+		};
+		if (h <= edge * 2.0f)
+			l_addRows(0.0f, h);
+		else
+		{
+			l_addRows(0.0f, edge);
+			l_addRows(edge, h - edge);
+			l_addRows(h - edge, h);
+		}
+		rows.push_back(h);
+
+		ostd::Color color = vpd.blur.prepareSliceGlowColor(note.glowColor);
+		float texY = res.getGlowSliceRow(boxW);
+		auto l_vertex = [&](float tx, float ty, float profile) -> sf::Vertex {
+			sf::Color shaded((uint8_t)(color.r * profile + 0.5f), (uint8_t)(color.g * profile + 0.5f), (uint8_t)(color.b * profile + 0.5f), (uint8_t)(color.a * profile + 0.5f));
+			return { { x + tx, y + ty }, shaded, { res.getGlowSliceTexel(tx, boxW), texY } };
+		};
+		for (size_t r = 0; r + 1 < rows.size(); r++)
+		{
+			float top = std::clamp(res.getGlowProfile(rows[r], boxH), 0.0f, 1.0f);
+			float bottom = std::clamp(res.getGlowProfile(rows[r + 1], boxH), 0.0f, 1.0f);
+			for (size_t c = 0; c + 1 < columns.size(); c++)
+			{
+				sf::Vertex topLeft = l_vertex(columns[c], rows[r], top);
+				sf::Vertex topRight = l_vertex(columns[c + 1], rows[r], top);
+				sf::Vertex bottomLeft = l_vertex(columns[c], rows[r + 1], bottom);
+				sf::Vertex bottomRight = l_vertex(columns[c + 1], rows[r + 1], bottom);
+				vertices.append(topLeft);
+				vertices.append(topRight);
+				vertices.append(bottomLeft);
+				vertices.append(bottomLeft);
+				vertices.append(topRight);
+				vertices.append(bottomRight);
+			}
+		}
+	}
+
+	sf::RenderStates states;
+	states.texture = &res.glowSliceTexture;
+	states.blendMode = sf::BlendMode(sf::BlendMode::Factor::One, sf::BlendMode::Factor::One, sf::BlendMode::Equation::Add);
+	Renderer::useTexture(nullptr);
+	Renderer::useShader(nullptr);
+	Renderer::useRenderStates(&states);
+	Renderer::drawVertexArray(vertices);
+	Renderer::useRenderStates(nullptr);
+}
+
+void VirtualKeyboard::__build_note_graphics(const std::vector<tNoteLayout>& layout, std::vector<FallingNoteGraphicsData>& outGfx, bool black)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	std::array<float, 88> keyOffsets;
+	auto& offsetMap = vpd.keyOffsets();
+	for (int32_t i = 0; i < 88; i++)
+		keyOffsets[i] = offsetMap[i];
+
+	ostd::Color noteColor = (black ? vpd.fallingBlackNoteColor : vpd.fallingWhiteNoteColor);
+	ostd::Color outlineColor = (black ? vpd.fallingBlackNoteOutlineColor : vpd.fallingWhiteNoteOutlineColor);
+	ostd::Color glowColor = (black ? vpd.fallingBlackNoteGlowColor : vpd.fallingWhiteNoteGlowColor);
+	float shrink = (black ? vpd.blackKey_shrink() : vpd.whiteKey_shrink());
+	float width = (black ? vpd.blackKey_w() : vpd.whiteKey_w()) - shrink;
+	int32_t outlineThickness = -(black ? vpd.fallingBlackNoteOutlineWidth : vpd.fallingWhiteNoteOutlineWidth);
+	float cornerRadius = (black ? vpd.fallingBlackNoteBorderRadius : vpd.fallingWhiteNoteBorderRadius);
+	sf::Texture* texture = &m_vpiano.vPianoRes().noteTexture;
+
+	// Every note owns output slot i, so chunks never touch each other's data and the
+	// result is the same as filling the list serially
+	outGfx.resize(layout.size());
+	ThreadPool::shared().parallelFor(layout.size(), GeometryChunkSize, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			const auto& note = layout[i];
+			auto& gfx = outGfx[i];
+			gfx.rect = { keyOffsets[note.keyIndex] + (shrink / 2.0f), note.y, width, note.h };
+			gfx.fillColor = noteColor;
+			gfx.outlineColor = outlineColor;
+			gfx.glowColor = glowColor;
+			if (vpd.usePerNoteColors)
+			{
+				gfx.fillColor = vpd.perNoteColors[note.noteInOctave];
+				gfx.outlineColor = vpd.perNoteColors[note.noteInOctave + 12];
+				gfx.glowColor = vpd.perNoteColors[note.noteInOctave + 24];
+			}
+			gfx.texture = texture;
+			gfx.outlineThickness = outlineThickness;
+			gfx.cornerRadius = cornerRadius;
+		}
+	});
+}
+
+void VirtualKeyboard::__push_note_graphics(const ostd::MidiParser::NoteInfo& noteInfo, float y, float h)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	bool black = noteInfo.isBlackKey();
+	ostd::Color noteColor = (black ? vpd.fallingBlackNoteColor : vpd.fallingWhiteNoteColor);
+	ostd::Color outlineColor = (black ? vpd.fallingBlackNoteOutlineColor : vpd.fallingWhiteNoteOutlineColor);
+	ostd::Color glowColor = (black ? vpd.fallingBlackNoteGlowColor : vpd.fallingWhiteNoteGlowColor);
+	if (vpd.usePerNoteColors)
+	{
+		noteColor = vpd.perNoteColors[noteInfo.noteInOctave];
+		outlineColor = vpd.perNoteColors[noteInfo.noteInOctave + 12];
+		glowColor = vpd.perNoteColors[noteInfo.noteInOctave + 24];
+	}
+	float shrink = (black ? vpd.blackKey_shrink() : vpd.whiteKey_shrink());
+	float width = (black ? vpd.blackKey_w() : vpd.whiteKey_w()) - shrink;
+	float x = vpd.keyOffsets()[noteInfo.keyIndex] + (shrink / 2.0f);
+	auto& gfxList = (black ? m_fallingNoteGfx_b : m_fallingNoteGfx_w);
+	gfxList.push_back(FallingNoteGraphicsData {
+		{ x, y, width, h },
+		noteColor,
+		outlineColor,
+		glowColor,
+		&m_vpiano.vPianoRes().noteTexture,
+		-(black ? vpd.fallingBlackNoteOutlineWidth : vpd.fallingWhiteNoteOutlineWidth),
+		(black ? vpd.fallingBlackNoteBorderRadius : vpd.fallingWhiteNoteBorderRadius)
+	});
+}
+
+void VirtualKeyboard::__rebase_note_list(const NoteStore& noteList, double maxDuration, double currentTime)
+{
+	m_noteList = &noteList;
+	// Keys held by the dropped notes would otherwise stay down, the rebuilt set presses
+	// them again on the next update if they are still playing
+	for (auto& note : m_activeFallingNotes)
+	{
+		auto& key = m_pianoKeys[ostd::MidiParser::getNoteInfo(note.pitch).keyIndex];
+		key.pressed = false;
+		key.pressedForce = { 0.0f, 0.0f };
+	}
+	m_activeFallingNotes.clear();
+	double fallingTime = m_vpiano.vPianoData().fallingTime_s;
+	auto it = std::upper_bound(noteList.begin(), noteList.end(), currentTime, [fallingTime](double time, const PackedNote& note) {
+		return time < note.startTime - fallingTime;
+	});
+	m_nextFallingNoteIndex = (int32_t)std::distance(noteList.begin(), it);
+	// Only notes that started less than maxDuration ago can still be on screen
+	int32_t first = m_nextFallingNoteIndex;
+	while (first > 0 && noteList[first - 1].startTime >= currentTime - maxDuration - 0.05)
+		first--;
+	for (int32_t i = first; i < m_nextFallingNoteIndex; i++)
+	{
+		if (currentTime <= noteList[i].endTime() + 0.05)
+			m_activeFallingNotes.push_back(noteList[i]);
+	}
+	std::make_heap(m_activeFallingNotes.begin(), m_activeFallingNotes.end(), __ends_later);
+}
+
+void VirtualKeyboard::invalidateKeyboardCache(void)
+{
+	for (auto& layer : m_keyboardLayers)
+		layer.valid = false;
+}
+
+VirtualKeyboard::tKeyboardLayer& VirtualKeyboard::__get_keyboard_layer(const sf::Vector2u& targetSize)
+{
+	ostd::Vec2 scale = m_vpiano.vPianoData().getScale();
+	for (auto& layer : m_keyboardLayers)
+	{
+		if (layer.valid && layer.targetSize == targetSize && layer.scale.x == scale.x && layer.scale.y == scale.y)
+			return layer;
+	}
+	auto& layer = m_keyboardLayers[m_nextKeyboardLayer];
+	m_nextKeyboardLayer = (m_nextKeyboardLayer + 1) % m_keyboardLayers.size();
+	__rebuild_keyboard_layer(layer, targetSize);
+	return layer;
+}
+
+void VirtualKeyboard::__rebuild_keyboard_layer(tKeyboardLayer& layer, const sf::Vector2u& targetSize)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	// Leave room above vpy() for the piano lines and the outlines of the keys
+	float originY = std::max(std::floor(vpd.vpy()) - 4.0f, 0.0f);
+	uint32_t height = (targetSize.y > (uint32_t)originY ? targetSize.y - (uint32_t)originY : 1);
+	if (layer.texture.getSize().x != targetSize.x || layer.texture.getSize().y != height)
+		layer.texture = sf::RenderTexture({ std::max(targetSize.x, 1u), height });
+
+	sf::View view(sf::FloatRect({ 0.0f, originY }, { (float)targetSize.x, (float)height }));
+	layer.texture.setView(view);
+	layer.texture.clear(sf::Color::Transparent);
+	Renderer::setRenderTarget(&layer.texture);
+	Renderer::useShader(nullptr);
+	Renderer::useTexture(nullptr);
+
+	int32_t whiteKeyCount = 0;
+	for (int32_t midiNote = 21; midiNote <= 108; ++midiNote)
+	{
+		if (!ostd::MidiParser::NoteInfo::isWhiteKey(midiNote % 12)) continue;
+		__draw_white_key(whiteKeyCount, false);
+		whiteKeyCount++;
+	}
+	__draw_piano_lines(vpd.vpx(), (float)m_vpiano.getParentWindow().getWindowWidth());
+	whiteKeyCount = 0;
+	for (int32_t midiNote = 21; midiNote <= 108; ++midiNote)
+	{
+		if (ostd::MidiParser::NoteInfo::isWhiteKey(midiNote % 12))
+		{
+			whiteKeyCount++;
+			continue;
+		}
+		__draw_black_key(whiteKeyCount, false);
+	}
+	layer.texture.display();
+	Renderer::setRenderTarget(nullptr);
+	__build_key_overlay(layer);
+
+	layer.targetSize = targetSize;
+	layer.scale = vpd.getScale();
+	layer.originY = originY;
+	layer.valid = true;
+}
+
+void VirtualKeyboard::__update_emission_rects(void)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	int32_t whiteKeyCount = 0;
+	for (int32_t midiNote = 21; midiNote <= 108; ++midiNote)
+	{
+		auto info = ostd::MidiParser::getNoteInfo(midiNote);
+		PianoKey& pk = m_pianoKeys[info.keyIndex];
+		float y = vpd.vpy();
+		if (ostd::MidiParser::NoteInfo::isWhiteKey(midiNote % 12))
+		{
+			float x = vpd.vpx() + (whiteKeyCount * vpd.whiteKey_w());
+			pk.particles.setEmissionRect({ x + (vpd.whiteKey_w() / 2.0f) - (vpd.whiteKey_w() / 8.0f), y - 2.0f, vpd.whiteKey_w() / 4.0f, 2.0f });
+			whiteKeyCount++;
+		}
+		else
+		{
+			float x = vpd.vpx() + ((whiteKeyCount - 1) * vpd.whiteKey_w() + (vpd.whiteKey_w() - vpd.blackKey_w() / 2.0f)) - vpd.blackKey_offset();
+			pk.particles.setEmissionRect({ x + (vpd.blackKey_w() / 2.0f) - (vpd.blackKey_w() / 8.0f), y - 2.0f, vpd.blackKey_w() / 4.0f, 2.0f });
+		}
+	}
+}
+
+void VirtualKeyboard::__build_key_overlay(tKeyboardLayer& layer)
+{
+	// White keys first, each followed by its piano lines, then the black keys on top.
+	// Region sizes match what __write_outlined_shape produces for the shapes involved
+	size_t whiteVertices = 3 * 9 * 4;
+	size_t blackVertices = 9 * 4 * (size_t)std::max(Renderer::getRoundedRectCornerResolution(), 2);
+	size_t vertexCount = 0;
+	for (bool black : { false, true })
+	{
+		for (int32_t midiNote = 21; midiNote <= 108; ++midiNote)
+		{
+			if (ostd::MidiParser::NoteInfo::isWhiteKey(midiNote % 12) == black) continue;
+			auto info = ostd::MidiParser::getNoteInfo(midiNote);
+			layer.keyFirstVertex[info.keyIndex] = vertexCount;
+			layer.keyVertexCount[info.keyIndex] = (black ? blackVertices : whiteVertices);
+			vertexCount += layer.keyVertexCount[info.keyIndex];
+		}
+	}
+	layer.keyOverlay.clear();
+	layer.keyOverlay.resize(vertexCount);
+	layer.keyOverlayState.fill(eKeyOverlay::Hidden);
+}
+
+void VirtualKeyboard::__update_key_overlay(tKeyboardLayer& layer)
+{
+	// A pressed white key covers the piano lines and the two neighbouring black keys,
+	// so those black keys are shown, unpressed, as well
+	int32_t whiteKeyCount = 0;
+	for (int32_t midiNote = 21; midiNote <= 108; ++midiNote)
+	{
+		auto info = ostd::MidiParser::getNoteInfo(midiNote);
+		bool black = !ostd::MidiParser::NoteInfo::isWhiteKey(midiNote % 12);
+		if (!black) whiteKeyCount++;
+		eKeyOverlay overlay = eKeyOverlay::Hidden;
+		if (m_pianoKeys[info.keyIndex].pressed)
+			overlay = eKeyOverlay::Pressed;
+		else if (black && (m_pianoKeys[info.keyIndex - 1].pressed || m_pianoKeys[info.keyIndex + 1].pressed))
+			overlay = eKeyOverlay::Unpressed;
+		if (layer.keyOverlayState[info.keyIndex] == overlay) continue;
+		__write_key_overlay(layer, info.keyIndex, (black ? whiteKeyCount : whiteKeyCount - 1), black, overlay);
+		layer.keyOverlayState[info.keyIndex] = overlay;
+	}
+}
+
+void VirtualKeyboard::__write_key_overlay(tKeyboardLayer& layer, int32_t keyIndex, int32_t whiteKeyIndex, bool black, eKeyOverlay overlay)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	size_t first = layer.keyFirstVertex[keyIndex];
+	size_t end = first + layer.keyVertexCount[keyIndex];
+	if (overlay == eKeyOverlay::Hidden)
+	{
+		for (size_t i = first; i < end; i++)
+			layer.keyOverlay[i] = sf::Vertex {};
+		return;
+	}
+	bool pressed = (overlay == eKeyOverlay::Pressed);
+	if (black)
+	{
+		auto rect = __get_black_key_rect(whiteKeyIndex);
+		RoundedRectangleShape key({ rect.w, rect.h }, 0.0f, 0.0f, BlackKeyCornerRadius, BlackKeyCornerRadius, (size_t)Renderer::getRoundedRectCornerResolution());
+		key.setPosition({ rect.x, rect.y });
+		__write_outlined_shape(layer.keyOverlay, first, key, (pressed ? vpd.blackKeyPressedColor : vpd.blackKeyColor), vpd.blackKeySplitColor, 1.0f);
+		return;
+	}
+	auto rect = __get_white_key_rect(whiteKeyIndex);
+	sf::RectangleShape key({ rect.w, rect.h });
+	key.setPosition({ rect.x, rect.y });
+	first += __write_outlined_shape(layer.keyOverlay, first, key, (pressed ? vpd.whiteKeyPressedColor : vpd.whiteKeyColor), vpd.whiteKeySplitColor, 1.0f);
+	// Same rectangles as __draw_piano_lines over the key and one pixel on each side
+	sf::RectangleShape line1({ rect.w + 2.0f, 2.0f });
+	line1.setPosition({ rect.x - 1.0f, vpd.vpy() - 2.0f });
+	first += __write_outlined_shape(layer.keyOverlay, first, line1, vpd.pianoLineColor1, vpd.pianoLineColor1, 1.0f);
+	sf::RectangleShape line2({ rect.w + 2.0f, 5.0f });
+	line2.setPosition({ rect.x - 1.0f, vpd.vpy() });
+	__write_outlined_shape(layer.keyOverlay, first, line2, vpd.pianoLineColor2, vpd.pianoLineColor2, 1.0f);
+}
+
+size_t VirtualKeyboard::__write_outlined_shape(sf::VertexArray& vertices, size_t first, const sf::Shape& shape, const ostd::Color& fillColor, const ostd::Color& outlineColor, float outlineThickness)
+{
+	// The triangles sf::Shape draws: a fan around the centre of the points, and the
+	// outline pushed out along the mitred edge normals. 9 vertices per point
+	size_t count = shape.getPointCount();
+	std::vector<sf::Vector2f> points(count);
+	sf::Vector2f low { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	sf::Vector2f high { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+	for (size_t i = 0; i < count; i++)
+	{
+		points[i] = shape.getTransform().transformPoint(shape.getPoint(i));
+		low = { std::min(low.x, points[i].x), std::min(low.y, points[i].y) };
+		high = { std::max(high.x, points[i].x), std::max(high.y, points[i].y) };
+	}
+	sf::Vector2f center = (low + high) / 2.0f;
+	auto l_normal = [&center](const sf::Vector2f& p1, const sf::Vector2f& p2) -> sf::Vector2f {
+		sf::Vector2f normal { p1.y - p2.y, p2.x - p1.x };
+		float length = normal.length();
+		if (length != 0.0f) normal /= length;
+		return (normal.dot(center - p1) > 0.0f ? -normal : normal);
+	};
+
+	sf::Color fill = sf_color(fillColor);
+	sf::Color outline = sf_color(outlineColor);
+	size_t v = first;
+	std::vector<sf::Vector2f> outer(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const auto& p0 = points[(i + count - 1) % count];
+		const auto& p1 = points[i];
+		const auto& p2 = points[(i + 1) % count];
+		sf::Vector2f n1 = l_normal(p0, p1);
+		sf::Vector2f n2 = l_normal(p1, p2);
+		outer[i] = p1 + ((n1 + n2) / (1.0f + n1.dot(n2))) * outlineThickness;
+		vertices[v++] = { center, fill };
+		vertices[v++] = { p1, fill };
+		vertices[v++] = { p2, fill };
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t next = (i + 1) % count;
+		vertices[v++] = { points[i], outline };
+		vertices[v++] = { outer[i], outline };
+		vertices[v++] = { points[next], outline };
+		vertices[v++] = { points[next], outline };
+		vertices[v++] = { outer[i], outline };
+		vertices[v++] = { outer[next], outline };
+	}
+	return v - first;
+}
+
+ostd::Rectangle VirtualKeyboard::__get_white_key_rect(int32_t whiteKeyIndex)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	return { vpd.vpx() + (whiteKeyIndex * vpd.whiteKey_w()), vpd.vpy(), vpd.whiteKey_w(), vpd.whiteKey_h() };
+}
+
+ostd::Rectangle VirtualKeyboard::__get_black_key_rect(int32_t whiteKeyIndex)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	float x = vpd.vpx() + ((whiteKeyIndex - 1) * vpd.whiteKey_w() + (vpd.whiteKey_w() - vpd.blackKey_w() / 2.0f)) - vpd.blackKey_offset();
+	return { x, vpd.vpy(), vpd.blackKey_w(), vpd.blackKey_h() };
+}
+
+void VirtualKeyboard::__draw_white_key(int32_t whiteKeyIndex, bool pressed)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	ostd::Color keyColor = (pressed ? vpd.whiteKeyPressedColor : vpd.whiteKeyColor);
+	Renderer::outlineRect(__get_white_key_rect(whiteKeyIndex), keyColor, vpd.whiteKeySplitColor, 1 );
+}
+
+void VirtualKeyboard::__draw_black_key(int32_t whiteKeyIndex, bool pressed)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	ostd::Color keyColor = (pressed ? vpd.blackKeyPressedColor : vpd.blackKeyColor);
+	Renderer::outlineRoundedRect(__get_black_key_rect(whiteKeyIndex), keyColor, vpd.blackKeySplitColor, { 0, 0, BlackKeyCornerRadius, BlackKeyCornerRadius }, 1);
+}
+
+void VirtualKeyboard::__draw_piano_lines(float x, float width)
+{
+	auto& vpd = m_vpiano.vPianoData();
+	Renderer::outlineRect({ x, vpd.vpy() - 2, width, 2 }, vpd.pianoLineColor1, vpd.pianoLineColor1, 1);
+	Renderer::outlineRect({ x, vpd.vpy(), width, 5 }, vpd.pianoLineColor2, vpd.pianoLineColor2, 1);
+}
+
 void VirtualKeyboard::__render_falling_notes(const std::vector<FallingNoteGraphicsData>& noteList)
 {
 	for (auto& note : noteList)
@@ -405,17 +1007,13 @@ void VirtualKeyboard::__render_hollow_note_negatives(const std::vector<FallingNo
 	{
 		Renderer::useTexture(nullptr);
 		Renderer::useShader(nullptr);
-		auto margins = m_vpiano.vPianoData().getGlowMargins();
-		margins.x = -2;
-		margins.y = -2;
-		margins.w = -2;
-		margins.h = -2;
 		ostd::Rectangle bounds = {
-			note.rect.x - margins.x,
-			note.rect.y - margins.y,
-			note.rect.w + margins.x + margins.w,
-			note.rect.h + margins.y + margins.h
+			note.rect.x + HollowNegativeInset,
+			note.rect.y + HollowNegativeInset,
+			note.rect.w - (HollowNegativeInset * 2.0f),
+			note.rect.h - (HollowNegativeInset * 2.0f)
 		};
-		Renderer::fillRoundedRect(bounds, { 0, 0, 0, 255 }, { 10, 10, 10, 10 });
+		float radius = HollowNegativeCornerRadius;
+		Renderer::fillRoundedRect(bounds, { 0, 0, 0, 255 }, { radius, radius, radius, radius });
 	}
 }
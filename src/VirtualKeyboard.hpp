@@ -21,12 +21,52 @@
 #pragma once
 
 #include "VPianoData.hpp"
-#include <deque>
+#include "NoteStore.hpp"
+#include "LiveMidiInput.hpp"
+#include "NoteMesh.hpp"
+#include "AnalyticParticles.hpp"
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <array>
 #include <ostd/Midi.hpp>
 #include <vector>
 
 class VirtualKeyboard
 {
+	public: enum class eKeyOverlay : uint8_t { Hidden = 0, Unpressed, Pressed };
+	public: struct tKeyboardLayer
+	{
+		sf::RenderTexture texture;
+		sf::Vector2u targetSize { 0, 0 };
+		ostd::Vec2 scale { 0.0f, 0.0f };
+		float originY { 0.0f };
+		bool valid { false };
+
+		// Drawn over the texture: one fixed vertex region per key, rewritten only when
+		// what the key shows changes. Hidden regions are collapsed to a point
+		sf::VertexArray keyOverlay { sf::PrimitiveType::Triangles };
+		std::array<size_t, 88> keyFirstVertex {};
+		std::array<size_t, 88> keyVertexCount {};
+		std::array<eKeyOverlay, 88> keyOverlayState {};
+	};
+
+	public: struct tLiveNote
+	{
+		double startTime { 0.0 };
+		double endTime { 0.0 };
+		uint8_t pitch { 0 };
+		uint8_t velocity { 0 };
+		bool held { true };
+	};
+
+	private: struct tNoteLayout
+	{
+		float y { 0.0f };
+		float h { 0.0f };
+		int32_t keyIndex { 0 };
+		int32_t noteInOctave { 0 };
+		bool black { false };
+	};
+
 	public:
 		VirtualKeyboard(VirtualPiano& vpiano);
 		void init(void);
@@ -37,8 +77,37 @@ class VirtualKeyboard
 		void renderFallingNotes(std::optional<std::reference_wrapper<sf::RenderTarget>> target = std::nullopt);
 		void renderFallingNotesGlow(std::optional<std::reference_wrapper<sf::RenderTarget>> target = std::nullopt);
 		void renderHollowNoteNegative(std::optional<std::reference_wrapper<sf::RenderTarget>> target = std::nullopt);
+		void invalidateKeyboardCache(void);
+		bool getGlowRegion(ostd::Rectangle& outRegion);
+		inline void invalidateNoteMesh(void) { m_noteMesh.clear(); }
+		void applyLiveEvent(const tLiveMidiEvent& evt, uint16_t particleBurst);
+		void updateLiveNotes(double currentTime);
+		void clearLiveNotes(void);
+		bool useAnalyticParticles(void);
+
+	private: enum class eNoteMeshPass { Notes = 0, Glow, HollowNegative, GlowSlices };
 
 	private:
+		bool __use_note_mesh(void);
+		void __render_note_mesh(eNoteMeshPass pass);
+		bool __use_glow_slices(void);
+		void __render_glow_slices(const std::vector<FallingNoteGraphicsData>& noteList, bool black);
+		void __rebase_note_list(const NoteStore& noteList, double maxDuration, double currentTime);
+		tKeyboardLayer& __get_keyboard_layer(const sf::Vector2u& targetSize);
+		void __rebuild_keyboard_layer(tKeyboardLayer& layer, const sf::Vector2u& targetSize);
+		void __update_emission_rects(void);
+		void __build_key_overlay(tKeyboardLayer& layer);
+		void __update_key_overlay(tKeyboardLayer& layer);
+		void __write_key_overlay(tKeyboardLayer& layer, int32_t keyIndex, int32_t whiteKeyIndex, bool black, eKeyOverlay overlay);
+		size_t __write_outlined_shape(sf::VertexArray& vertices, size_t first, const sf::Shape& shape, const ostd::Color& fillColor, const ostd::Color& outlineColor, float outlineThickness);
+		ostd::Rectangle __get_white_key_rect(int32_t whiteKeyIndex);
+		ostd::Rectangle __get_black_key_rect(int32_t whiteKeyIndex);
+		void __draw_white_key(int32_t whiteKeyIndex, bool pressed);
+		void __draw_black_key(int32_t whiteKeyIndex, bool pressed);
+		void __draw_piano_lines(float x, float width);
+		inline static bool __ends_later(const PackedNote& a, const PackedNote& b) { return a.endTime() > b.endTime(); }
+		void __build_note_graphics(const std::vector<tNoteLayout>& layout, std::vector<FallingNoteGraphicsData>& outGfx, bool black);
+		void __push_note_graphics(const ostd::MidiParser::NoteInfo& noteInfo, float y, float h);
 		void __render_falling_notes(const std::vector<FallingNoteGraphicsData>& noteList);
 		void __render_falling_notes_glow(const std::vector<FallingNoteGraphicsData>& noteList);
 		void __render_hollow_note_negatives(const std::vector<FallingNoteGraphicsData>& noteList);
@@ -47,10 +116,35 @@ class VirtualKeyboard
 		VirtualPiano& m_vpiano;
 
 		std::vector<PianoKey> m_pianoKeys;
-		std::deque<ostd::MidiParser::NoteEvent> m_activeFallingNotes;
+		// Min-heap on end time, so a long sustained note never keeps finished notes alive
+		std::vector<PackedNote> m_activeFallingNotes;
 		std::vector<FallingNoteGraphicsData> m_fallingNoteGfx_w;
 		std::vector<FallingNoteGraphicsData> m_fallingNoteGfx_b;
+		// Layout of every active note, same order as m_activeFallingNotes
+		std::vector<tNoteLayout> m_noteLayout;
+		std::vector<tNoteLayout> m_noteLayout_w;
+		std::vector<tNoteLayout> m_noteLayout_b;
 		int32_t m_nextFallingNoteIndex { 0 };
+		const NoteStore* m_noteList { nullptr };
+		std::vector<tLiveNote> m_liveNotes;
+		NoteMesh m_noteMesh;
+		double m_visualTime { 0.0 };
+		std::array<sf::VertexArray, 2> m_glowSliceVertices;
+		ParticleBatch m_particleBatch;
+		AnalyticParticles m_analyticParticles;
+		bool m_analyticParticlesEnabled { false };
+
+		// The unpressed keyboard only changes on resize or style change, so it is kept
+		// pre-rendered. Two slots, because video export alternates window and output scale
+		std::array<tKeyboardLayer, 2> m_keyboardLayers;
+		uint8_t m_nextKeyboardLayer { 0 };
+
+	public:
+		inline static constexpr size_t GeometryChunkSize { 2048 };
+		inline static constexpr float BlackKeyCornerRadius { 5.0f };
+		// The hollow note mask is the note shrunk by this inset, with its own rounding
+		inline static constexpr float HollowNegativeInset { 2.0f };
+		inline static constexpr float HollowNegativeCornerRadius { 10.0f };
 
 		friend class VirtualPiano;
 };
@@ -23,6 +23,7 @@
 #include "VPianoData.hpp"
 #include "Window.hpp"
 #include "Renderer.hpp"
+#include "ThreadPool.hpp"
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/Texture.hpp>
@@ -36,17 +37,13 @@ void VirtualPiano::init(void)
 	m_firstNotePlayed = false;
 	m_vPianoRes.loadShaders();
 	m_configJson.init("settings.json", true, &Common::DefaultSettingsJSON);
+	m_dynamicResolution = m_configJson.get_bool("settings.dynamicResolution");
+	m_frameBudget_ms = std::max(m_configJson.get_float("settings.frameBudget_ms"), 1.0f);
+	m_particleGovernor = m_configJson.get_bool("settings.particleGovernor");
 	m_vKeyboard.init();
 
 	sf::Vector2u winSize = { m_parentWindow.sfWindow().getSize().x, m_parentWindow.sfWindow().getSize().y };
-	sf::Vector2u winHalfSize = { winSize.x / m_vPianoData.blur.resolutionDivider, winSize.y / m_vPianoData.blur.resolutionDivider };
-	m_blurBuff1 = sf::RenderTexture(winSize);
-	m_blurBuff2 = sf::RenderTexture(winSize);
-	m_glowBuffer = sf::RenderTexture(winSize);
-	m_hollowBuff = sf::RenderTexture(winSize);
-	m_glowView.setSize({ (float)winSize.x, (float)winSize.y });
-	m_glowView.setCenter({ winSize.x / 2.f, winSize.y / 2.f });
-	m_glowBuffer.setView(m_glowView);
+	onWindowResized(winSize.x, winSize.y);
 }
 
 void VirtualPiano::loadProjectFile(const ostd::String& filePath)
@@ -104,19 +101,36 @@ void VirtualPiano::loadProjectFile(const ostd::String& filePath)
 	m_vPianoData.pressedVelocityMultiplier = m_projJson.get_float("project.particles.pressedVelocityMultiplier");
 
 	m_vPianoData.loadFromStyleJSON(m_styleJson);
+	m_vPianoRes.bakeGlowSlices(m_vPianoData);
+	m_vPianoRes.buildGaussianKernel(m_vPianoData, getSceneScale());
 	m_vKeyboard.loadFromStyleJSON(m_partJson);
+	m_vKeyboard.invalidateKeyboardCache();
+	m_vKeyboard.invalidateNoteMesh();
+	invalidateIdleFrame();
+	m_bloomHistoryValid = false;
 }
 
-void VirtualPiano::onWindowResized(uint32_t width, uint32_t height)
+void VirtualPiano::onWindowResized(uint32_t width, uint32_t height, bool deferred)
 {
-	m_blurBuff1 = sf::RenderTexture({ width / m_vPianoData.blur.resolutionDivider, height / m_vPianoData.blur.resolutionDivider });
-	m_blurBuff1 = sf::RenderTexture({ width / m_vPianoData.blur.resolutionDivider, height / m_vPianoData.blur.resolutionDivider });
-	m_glowBuffer = sf::RenderTexture({ width / m_vPianoData.blur.resolutionDivider, height / m_vPianoData.blur.resolutionDivider });
-	m_hollowBuff = sf::RenderTexture({ width / m_vPianoData.blur.resolutionDivider, height / m_vPianoData.blur.resolutionDivider });
-
+	// Interactive resizes arrive in bursts while a window edge is dragged. The glow view
+	// follows right away, the buffers behind it are swapped once the size settles
 	m_glowView.setSize({ (float)width, (float)height });
 	m_glowView.setCenter({ width / 2.f, height / 2.f });
-	m_glowBuffer.setView(m_glowView);
+	m_pendingTargetSize = { width, height };
+	m_targetResizePending = true;
+	// Direct resizes come from init and export, both of which start at full resolution
+	if (!deferred)
+		m_sceneScaleLevel = 0;
+	m_targetResizeClock.restart();
+	if (!deferred || m_glowBuffer == nullptr)
+		__apply_pending_resize();
+	else
+	{
+		m_glowBuffer->setView(m_glowView);
+		m_hollowBuff->setView(m_glowView);
+	}
+	m_vKeyboard.invalidateKeyboardCache();
+	invalidateIdleFrame();
 
 	if (m_showBackground)
 	{
@@ -132,6 +146,7 @@ void VirtualPiano::onWindowResized(uint32_t width, uint32_t height)
 // Playback functionality
 void VirtualPiano::play(void)
 {
+	if (isLiveInputActive()) return;
 	if (m_paused)
 	{
 		m_playing = true;
@@ -161,6 +176,7 @@ void VirtualPiano::stop(void)
 	m_pausedTime_ns = 0.0;
 	m_pausedOffset_ns = 0.0;
 	m_vKeyboard.m_nextFallingNoteIndex = 0;
+	m_vKeyboard.m_noteList = nullptr;
 	m_vKeyboard.m_activeFallingNotes.clear();
 	for (auto& pk : m_vKeyboard.m_pianoKeys)
 	{
@@ -168,8 +184,52 @@ void VirtualPiano::stop(void)
 		pk.particles.reset();
 		pk.particles.update();
 	}
+	m_vKeyboard.m_analyticParticles.reset();
 	m_vKeyboard.updateVisualization(getPlayTime_s());
 	m_playing = false;
+	invalidateIdleFrame();
+}
+
+void VirtualPiano::seek(double time_s)
+{
+	if (isLiveInputActive() || m_videoRenderer.isRenderingToFile()) return;
+	time_s = std::clamp(time_s, 0.0, std::max(m_vPianoRes.getSongEndTime(), 0.0));
+	double now = Common::getCurrentTIme_ns();
+	m_startTimeOffset_ns = now - time_s * 1e9;
+	m_pausedOffset_ns = 0.0;
+	if (!m_playing)
+	{
+		m_paused = true;
+		m_pausedTime_ns = now;
+	}
+
+	// The audio starts at autoSoundStart when the first note lands
+	auto& res = m_vPianoRes;
+	m_firstNotePlayed = time_s >= res.firstNoteStartTime;
+	if (res.hasAudioFile())
+	{
+		if (m_firstNotePlayed)
+		{
+			res.audioFile.play();
+			res.audioFile.setPlayingOffset(sf::seconds((float)(res.getAutoSoundStart() + (time_s - res.firstNoteStartTime))));
+			if (!m_playing)
+				res.audioFile.pause();
+		}
+		else
+			res.audioFile.stop();
+	}
+
+	// Clearing the list makes updateVisualization rebuild the active notes at the new time
+	m_vKeyboard.m_noteList = nullptr;
+	for (auto& pk : m_vKeyboard.m_pianoKeys)
+	{
+		pk.pressed = false;
+		pk.pressedForce = { 0.0f, 0.0f };
+	}
+	__warm_up_particles(time_s);
+	m_vKeyboard.updateVisualization(time_s);
+	m_bloomHistoryValid = false;
+	invalidateIdleFrame();
 }
 
 double VirtualPiano::getPlayTime_s(void)
@@ -181,6 +241,90 @@ double VirtualPiano::getPlayTime_s(void)
 
 
 
+// Live input
+bool VirtualPiano::startLiveInput(const ostd::String& source)
+{
+	stop();
+	m_vKeyboard.clearLiveNotes();
+	if (!m_liveInput.open(source))
+		return false;
+	m_liveLatency = LiveMidiInput::tLatencyStats();
+	m_pendingLatencySamples_ns.clear();
+	m_liveStatsStart_ns = Common::getCurrentTIme_ns();
+	return true;
+}
+
+void VirtualPiano::stopLiveInput(void)
+{
+	m_liveInput.close();
+	m_vKeyboard.clearLiveNotes();
+	m_pendingLatencySamples_ns.clear();
+	// Back to a stopped piano, without the particles of the last live notes
+	stop();
+}
+
+void VirtualPiano::onFrameDisplayed(void)
+{
+	// Only the gap between two active frames is a frame time. The first frame after
+	// idling would measure the waitEvent sleep, so it reports 0 and is skipped
+	double now_ns = Common::getCurrentTIme_ns();
+	bool active = !isIdle() && !m_videoRenderer.isRenderingToFile();
+	double frameTime_ms = (active && m_lastFrameDisplayed_ns > 0.0 ? (now_ns - m_lastFrameDisplayed_ns) * 1e-6 : 0.0);
+	m_lastFrameDisplayed_ns = (active ? now_ns : 0.0);
+	__update_particle_governor(frameTime_ms);
+	__update_dynamic_resolution(frameTime_ms);
+	if (!isLiveInputActive()) return;
+
+	// Input-to-photon is approximated as event timestamp to the return of display(),
+	// which includes the vsync wait but not the monitor's own scanout
+	for (double timestamp_ns : m_pendingLatencySamples_ns)
+	{
+		double latency_ms = (now_ns - timestamp_ns) * 1e-6;
+		m_liveLatency.sum_ms += latency_ms;
+		m_liveLatency.max_ms = std::max(m_liveLatency.max_ms, latency_ms);
+		m_liveLatency.last_ms = latency_ms;
+		m_liveLatency.samples++;
+	}
+	m_pendingLatencySamples_ns.clear();
+	m_liveLatency.frameTimeSum_ms += frameTime_ms;
+	m_liveLatency.frames++;
+
+	if (now_ns - m_liveStatsStart_ns < 5e9) return;
+	if (m_liveLatency.samples > 0)
+	{
+		double avgLatency_ms = m_liveLatency.sum_ms / m_liveLatency.samples;
+		double avgFrame_ms = m_liveLatency.frameTimeSum_ms / std::max(m_liveLatency.frames, 1);
+		OX_DEBUG("Live input latency: avg %.2f ms, max %.2f ms over %d events (frame time %.2f ms, %d dropped).",
+				 avgLatency_ms, m_liveLatency.max_ms, m_liveLatency.samples, avgFrame_ms, (int32_t)m_liveInput.getDroppedEventCount());
+		if (m_liveLatency.max_ms > avgFrame_ms)
+			OX_WARN("Live input latency exceeded one frame (%.2f ms > %.2f ms).", m_liveLatency.max_ms, avgFrame_ms);
+	}
+	m_liveLatency = LiveMidiInput::tLatencyStats();
+	m_liveStatsStart_ns = now_ns;
+}
+
+void VirtualPiano::__process_live_input(void)
+{
+	// Drained right before drawing rather than in the fixed update, so an event that
+	// arrives during a frame is on screen at the next display()
+	tLiveMidiEvent evt;
+	while (m_liveInput.poll(evt))
+	{
+		m_vKeyboard.applyLiveEvent(evt, m_partPerFrame);
+		m_pendingLatencySamples_ns.push_back(evt.timestamp_ns);
+	}
+	if (m_liveInput.isDisconnected())
+	{
+		OX_WARN("Live MIDI input disconnected, back to playback mode.");
+		stopLiveInput();
+		return;
+	}
+	m_vKeyboard.updateLiveNotes(Common::getCurrentTIme_ns() * 1e-9);
+}
+
+
+
+
 // Update and Render
 void VirtualPiano::update(void)
 {
@@ -193,19 +337,131 @@ void VirtualPiano::update(void)
 	{
 		m_vKeyboard.updateVisualization(getPlayTime_s());
 	}
-	if (m_playing || m_videoRenderer.isRenderingToFile())
+	if (m_playing || m_videoRenderer.isRenderingToFile() || isLiveInputActive())
+	{
+		double particleStart_ns = Common::getCurrentTIme_ns();
+		uint16_t emitCount = __get_particle_emit_count();
+		auto& keys = m_vKeyboard.m_pianoKeys;
+		if (m_vKeyboard.useAnalyticParticles())
+		{
+			// Only spawn events are recorded, the shader evaluates the particles
+			m_vKeyboard.m_analyticParticles.step();
+			for (auto& pk : keys)
+			{
+				if (pk.pressed)
+					m_vKeyboard.m_analyticParticles.spawn(pk.particles, pk.pressedForce, emitCount);
+			}
+		}
+		else
+		{
+			// Emitters only touch their own state and random stream, so keys can be
+			// simulated on any thread without changing the result
+			ThreadPool::shared().parallelFor(keys.size(), 1, [&keys, emitCount](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+				{
+					auto& pk = keys[i];
+					pk.particles.update(pk.pressedForce);
+					if (pk.pressed)
+						pk.particles.emit(emitCount);
+				}
+			});
+		}
+		m_particleTime_ms += (Common::getCurrentTIme_ns() - particleStart_ns) * 1e-6;
+	}
+}
+
+void VirtualPiano::__warm_up_particles(double time_s)
+{
+	auto& keys = m_vKeyboard.m_pianoKeys;
+	auto& analytic = m_vKeyboard.m_analyticParticles;
+	for (auto& pk : keys)
+	{
+		pk.particles.reset();
+		pk.particles.update();
+	}
+	analytic.reset();
+	if (keys.empty()) return;
+
+	// Only particles emitted within the longest particle life are still visible, so the
+	// keys pressed in that window are replayed from the timeline without rendering
+	double start_ns = Common::getCurrentTIme_ns();
+	int32_t frameCount = (int32_t)keys[0].particles.getDefaultParticleInfo().maxLifeFrames();
+	if (frameCount <= 0) return;
+	double frameTime = 1.0 / ParticleUpdateRate;
+	double windowStart = time_s - frameCount * frameTime;
+
+	// Frame f (1 to frameCount) runs at windowStart + f * frameTime, a key is down from
+	// the start of a note to its end
+	struct tPress { int32_t first; int32_t last; ostd::Vec2 force; };
+	std::vector<std::vector<tPress>> presses(keys.size());
+	double maxDuration = 0.0;
+	auto& noteList = m_vPianoRes.getNoteList(m_vPianoData.pps(), &maxDuration);
+	auto it = std::lower_bound(noteList.begin(), noteList.end(), windowStart - maxDuration, [](const PackedNote& note, double time) {
+		return note.startTime < time;
+	});
+	for (; it != noteList.end() && it->startTime <= time_s; ++it)
+	{
+		if (it->endTime() <= windowStart) continue;
+		int32_t first = std::max((int32_t)std::ceil((it->startTime - windowStart) / frameTime), 1);
+		int32_t last = std::min((int32_t)std::ceil((it->endTime() - windowStart) / frameTime) - 1, frameCount);
+		if (first > last) continue;
+		auto info = ostd::MidiParser::getNoteInfo(it->pitch);
+		if (info.keyIndex < 0 || info.keyIndex >= (int32_t)keys.size()) continue;
+		ostd::Vec2 force { 0.0f, -((float)(it->velocity / 128.0f)) * (float)m_vPianoData.pressedVelocityMultiplier };
+		presses[info.keyIndex].push_back({ first, last, force });
+	}
+	auto l_pressAt = [&presses](size_t key, int32_t frame) -> const tPress* {
+		for (auto& press : presses[key])
+		{
+			if (frame >= press.first && frame <= press.last)
+				return &press;
+		}
+		return nullptr;
+	};
+
+	uint16_t emitCount = __get_particle_emit_count();
+	if (m_vKeyboard.useAnalyticParticles())
 	{
-		for (auto& pk : m_vKeyboard.m_pianoKeys)
+		for (int32_t frame = 1; frame <= frameCount; frame++)
 		{
-			pk.particles.update(pk.pressedForce);
-			// if (pk.pressedForce.y != 0)
-			// 	std::cout << pk.pressedForce << "\n";
-			if (pk.pressed)
+			analytic.step();
+			for (size_t i = 0; i < keys.size(); i++)
 			{
-				pk.particles.emit(m_partPerFrame);
+				if (presses[i].empty()) continue;
+				if (auto press = l_pressAt(i, frame))
+					analytic.spawn(keys[i].particles, press->force, emitCount);
 			}
 		}
 	}
+	else
+	{
+		std::vector<size_t> activeKeys;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (!presses[i].empty())
+				activeKeys.push_back(i);
+		}
+		// Same steps as update(), through the vector kernel only. The vertices are written
+		// once, on the last frame
+		ThreadPool::shared().parallelFor(activeKeys.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++)
+			{
+				auto& emitter = keys[activeKeys[k]].particles;
+				for (int32_t frame = 1; frame <= frameCount; frame++)
+				{
+					auto press = l_pressAt(activeKeys[k], frame);
+					ostd::Vec2 force = (press != nullptr ? press->force : ostd::Vec2 { 0.0f, 0.0f });
+					if (frame < frameCount)
+						emitter.simulate(force);
+					else
+						emitter.update(force);
+					if (press != nullptr)
+						emitter.emit(emitCount);
+				}
+			}
+		});
+	}
+	OX_DEBUG("Particle warm-up: %d frames in %.2f ms.", frameCount, (Common::getCurrentTIme_ns() - start_ns) * 1e-6);
 }
 
 void VirtualPiano::render(std::optional<std::reference_wrapper<sf::RenderTarget>> target)
@@ -232,8 +488,41 @@ void VirtualPiano::render(std::optional<std::reference_wrapper<sf::RenderTarget>
 	}
 	else
 	{
-		renderFrame(std::nullopt);
+		if (m_targetResizePending && m_targetResizeClock.getElapsedTime().asMilliseconds() >= ResizeSettleTime_ms)
+			__apply_pending_resize();
+		if (isLiveInputActive())
+			__process_live_input();
+		if (isIdle())
+			__render_idle_frame();
+		else
+		{
+			invalidateIdleFrame();
+			if (m_sceneTarget != nullptr)
+				__render_scaled_frame();
+			else
+				renderFrame(std::nullopt);
+		}
 	}
+	m_vPianoRes.renderTargets.endFrame();
+}
+
+void VirtualPiano::__render_idle_frame(void)
+{
+	// Notes, bloom and keyboard are composed once into m_idleFrame, later idle frames
+	// are a single textured quad under the GUI
+	if (!m_idleFrameValid)
+	{
+		sf::Vector2u size = m_parentWindow.sfWindow().getSize();
+		if (m_idleFrame == nullptr || m_idleFrame->getSize() != size)
+			m_vPianoRes.renderTargets.reacquire(m_idleFrame, size);
+		renderFrame(*m_idleFrame);
+		m_idleFrame->display();
+		m_idleFrameValid = true;
+	}
+	Renderer::setRenderTarget(nullptr);
+	Renderer::useTexture(nullptr);
+	Renderer::useShader(nullptr);
+	Renderer::drawTexture(m_idleFrame->getTexture());
 }
 
 void VirtualPiano::renderFrame(std::optional<std::reference_wrapper<sf::RenderTarget>> target)
@@ -242,20 +531,55 @@ void VirtualPiano::renderFrame(std::optional<std::reference_wrapper<sf::RenderTa
 	if (target)
 		__target = &target->get();
 
-	auto& blurBuffer = __apply_blur(m_vPianoData.blur.passes,
-										 m_vPianoData.blur.bloomIntensity,
-										 m_vPianoData.blur.startRadius,
-										 m_vPianoData.blur.increment,
-										 m_vPianoData.blur.threshold);
-
-	m_hollowBuff.clear(sf::Color::Transparent);
-    m_vKeyboard.renderHollowNoteNegative(m_hollowBuff);
-    m_hollowBuff.display();
+	// Bloom only runs where glow can end up: the glow bounds of the visible notes grown
+	// by the reach of the blur. Without visible notes it is skipped altogether
+	ostd::Rectangle glowRegion;
+	sf::RenderTexture* blurBuffer = nullptr;
+	sf::IntRect bloomRect;
+	sf::Vector2f bloomScale;
+	float bloomLag = 0.0f;
+	bool reused = false;
+	sf::FloatRect glowBounds;
+	bool hasGlow = m_vKeyboard.getGlowRegion(glowRegion);
+	if (hasGlow)
+	{
+		float reach = __get_bloom_reach();
+		sf::Vector2f viewSize = m_glowView.getSize();
+		float left = std::clamp(glowRegion.x - reach, 0.0f, viewSize.x);
+		float top = std::clamp(glowRegion.y - reach, 0.0f, viewSize.y);
+		float right = std::clamp(glowRegion.x + glowRegion.w + reach, 0.0f, viewSize.x);
+		float bottom = std::clamp(glowRegion.y + glowRegion.h + reach, 0.0f, viewSize.y);
+		hasGlow = (right > left && bottom > top);
+		glowBounds = sf::FloatRect({ left, top }, { right - left, bottom - top });
+	}
+	if (hasGlow)
+		reused = __reuse_bloom(glowBounds, bloomRect, bloomScale, bloomLag);
+	if (reused)
+		blurBuffer = m_bloomHistory[m_bloomHistoryIndex];
+	else if (hasGlow)
+	{
+		sf::Vector2f viewSize = m_glowView.getSize();
+		__set_bloom_scissor(sf::FloatRect({ glowBounds.position.x / viewSize.x, glowBounds.position.y / viewSize.y }, { glowBounds.size.x / viewSize.x, glowBounds.size.y / viewSize.y }));
+		// Measured rather than taken from the divider: until a deferred resize is
+		// applied the buffers still have the previous size
+		bloomScale = { viewSize.x / m_glowBuffer->getSize().x, viewSize.y / m_glowBuffer->getSize().y };
+		bloomRect = __get_bloom_rect(glowBounds, bloomScale, 0.0f);
+	}
+	if (hasGlow && !reused)
+	{
+		blurBuffer = &__apply_blur(m_vPianoData.blur.passes,
+									 m_vPianoData.blur.bloomIntensity,
+									 m_vPianoData.blur.startRadius,
+									 m_vPianoData.blur.increment,
+									 m_vPianoData.blur.threshold);
 
-    Renderer::setRenderTarget(&blurBuffer);
-    Renderer::useTexture(nullptr);
-	Renderer::useShader(nullptr);
-	Renderer::drawTexture(m_hollowBuff.getTexture(), { 0, 0 }, { (float)m_vPianoData.blur.resolutionDivider, (float)m_vPianoData.blur.resolutionDivider });  // Upscale
+		// Only rendered here, the composite below masks the bloom with it
+		m_hollowBuff->clear(sf::Color::Transparent);
+		m_vKeyboard.renderHollowNoteNegative(*m_hollowBuff);
+		m_hollowBuff->display();
+	}
+	if (!reused)
+		__seed_bloom_history(hasGlow ? blurBuffer : nullptr, bloomRect);
 
 	Renderer::setRenderTarget(__target);
 	Renderer::useTexture(nullptr);
@@ -264,11 +588,22 @@ void VirtualPiano::renderFrame(std::optional<std::reference_wrapper<sf::RenderTa
 	if (m_showBackground)
 		Renderer::drawSprite(*m_vPianoRes.backgroundSpr);
 
-	sf::RenderStates glowState;
-    glowState.blendMode = sf::BlendAdd;
-    Renderer::useRenderStates(&glowState);
-    Renderer::drawTexture(blurBuffer.getTexture(), { 0, 0 }, { (float)m_vPianoData.blur.resolutionDivider, (float)m_vPianoData.blur.resolutionDivider });  // Upscale
-    Renderer::useRenderStates(nullptr);
+	if (hasGlow)
+	{
+		// Only the bloom rectangle is composited, the rest of the buffer is empty
+		sf::Sprite glowSprite(blurBuffer->getTexture(), bloomRect);
+		glowSprite.setPosition({ bloomRect.position.x * bloomScale.x, bloomRect.position.y * bloomScale.y + bloomLag });
+		glowSprite.setScale(bloomScale);  // Upscale
+		auto& composite = m_vPianoRes.bloomCompositeShader;
+		composite.setUniform("texture", sf::Shader::CurrentTexture);
+		composite.setUniform("hollowMask", m_hollowBuff->getTexture());
+		sf::RenderStates glowState;
+		glowState.blendMode = sf::BlendAdd;
+		glowState.shader = &composite;
+		Renderer::useRenderStates(&glowState);
+		Renderer::drawSprite(glowSprite);
+		Renderer::useRenderStates(nullptr);
+	}
 
     m_vKeyboard.renderFallingNotes(target);
     m_vKeyboard.renderKeyboard(target);
@@ -276,6 +611,15 @@ void VirtualPiano::renderFrame(std::optional<std::reference_wrapper<sf::RenderTa
 
 sf::RenderTexture& VirtualPiano::__apply_blur(uint8_t passes, float intensity, float start_offset, float increment, float threshold)
 {
+	// The blur is baked into the glow slices, so the notes' glow is drawn straight
+	// into the glow buffer without any full-screen pass
+	if (m_vPianoData.blur.useGlowSlices && m_vPianoRes.glowSlicesReady)
+	{
+		m_glowBuffer->clear(sf::Color::Transparent);
+		m_vKeyboard.renderFallingNotesGlow(*m_glowBuffer);
+		m_glowBuffer->display();
+		return *m_glowBuffer;
+	}
 	switch (m_vPianoData.blur.type)
 	{
 		case VirtualPianoData::eBlurType::Gaussian:
@@ -285,25 +629,22 @@ sf::RenderTexture& VirtualPiano::__apply_blur(uint8_t passes, float intensity, f
 		default: break;
 	}
 	OX_ERROR("Invalid blur type");
-	return m_glowBuffer;
+	return *m_glowBuffer;
 }
 
 sf::RenderTexture& VirtualPiano::__apply_kawase_blur(uint8_t passes, float intensity, float start_offset, float increment, float threshold)
 {
-	m_glowBuffer.clear(sf::Color::Transparent);
-    m_vKeyboard.renderFallingNotesGlow(m_glowBuffer);
-    m_glowBuffer.display();
-
-	m_blurBuff1.clear(sf::Color::Transparent);
-	Renderer::setRenderTarget(&m_blurBuff1);
-	Renderer::useShader(&m_vPianoRes.thresholdShader);
-	m_vPianoRes.thresholdShader.setUniform("texture", m_glowBuffer.getTexture());
-	m_vPianoRes.thresholdShader.setUniform("threshold", threshold);
-	Renderer::drawTexture(m_glowBuffer.getTexture());
-	m_blurBuff1.display();
+	m_glowBuffer->clear(sf::Color::Transparent);
+    m_vKeyboard.renderFallingNotesGlow(*m_glowBuffer);
+    m_glowBuffer->display();
 
+	// Each pass draws the source texture stretched over the destination, so sampling
+	// a larger or smaller texture is all it takes to move between pyramid levels.
+	// The threshold is applied to the taps of the first downsample
 	auto blurPass = [&](sf::RenderTexture& src, sf::RenderTexture& dst, sf::Shader& shader, float offset, float intensity) {
         shader.setUniform("texture", src.getTexture());
+        shader.setUniform("applyThreshold", &src == m_glowBuffer);
+        shader.setUniform("threshold", threshold);
         shader.setUniform("resolution", sf::Vector2f({ 1.0f / dst.getSize().x, 1.0f / dst.getSize().y }));
         shader.setUniform("offset", offset);
         shader.setUniform("bloomStrength", intensity);
@@ -311,78 +652,432 @@ sf::RenderTexture& VirtualPiano::__apply_kawase_blur(uint8_t passes, float inten
         dst.clear(sf::Color::Transparent);
         Renderer::setRenderTarget(&dst);
         Renderer::useShader(&shader);
-        Renderer::drawTexture(src.getTexture());
+        Renderer::drawTexture(src.getTexture(), { 0.0f, 0.0f }, { (float)dst.getSize().x / src.getSize().x, (float)dst.getSize().y / src.getSize().y });
         dst.display();
     };
-    auto applyBlur = [&](sf::RenderTexture& buff1, sf::RenderTexture& buff2, uint8_t passes, float intensity, float increment) -> sf::RenderTexture& {
-		bool toggle = true;
-		float offset = start_offset;
-		for (int32_t i = 0; i < passes; i++)
-		{
-			if (toggle) blurPass(buff1, buff2, m_vPianoRes.kawaseDownShader, offset, intensity);
-			else blurPass(buff2, buff1, m_vPianoRes.kawaseDownShader, offset, intensity);
-			toggle = !toggle;
-			offset += increment;
-		}
-		auto& _buff1 = (toggle ? buff2 : buff1);
-		auto& _buff2 = (toggle ? buff1 : buff2);
-		toggle = true;
-		offset = start_offset;
-		for (int32_t i = 0; i < passes; i++)
-		{
-			if (toggle) blurPass(_buff1, _buff2, m_vPianoRes.kawaseUpShader, offset, intensity);
-			else blurPass(_buff2, _buff1, m_vPianoRes.kawaseUpShader, offset, intensity);
-			toggle = !toggle;
-			offset += increment;
-		}
-		return (toggle ? buff2 : buff1);
-    };
 
-    auto& finalBlurBuff = applyBlur(m_blurBuff1, m_blurBuff2, passes, intensity, increment);
+    // Down: full size -> 1/2 -> 1/4 ..., then back up level by level into m_blurBuff2.
+    // Every halving doubles the reach of a tap, so the same offsets blur wider than
+    // ping-ponging at full size while touching a fraction of the pixels
+    // Offsets are scaled with the scene so the blur keeps its width in window pixels
+    int32_t levels = std::min<int32_t>(passes, (int32_t)m_kawaseMips.size());
+    std::vector<float> offsets(levels);
+    for (int32_t i = 0; i < levels; i++)
+		offsets[i] = (start_offset + (i * increment)) * getSceneScale();
+    sf::RenderTexture* src = m_glowBuffer;
+    for (int32_t i = 0; i < levels; i++)
+    {
+		blurPass(*src, *m_kawaseMips[i], m_vPianoRes.kawaseDownShader, offsets[i], intensity);
+		src = m_kawaseMips[i];
+    }
+    for (int32_t i = levels - 1; i >= 0; i--)
+    {
+		sf::RenderTexture& dst = (i > 0 ? *m_kawaseMips[i - 1] : *m_blurBuff2);
+		blurPass(*src, dst, m_vPianoRes.kawaseUpShader, offsets[i], intensity);
+		src = &dst;
+    }
+    auto& finalBlurBuff = *src;
     Renderer::setRenderTarget(nullptr);
     Renderer::useShader(nullptr);
     Renderer::useTexture(nullptr);
     return finalBlurBuff;
 }
 
+float VirtualPiano::__get_bloom_reach(void)
+{
+	// How far, in window pixels, the bloom can spread light past the glow shapes
+	auto& blur = m_vPianoData.blur;
+	if (blur.useGlowSlices && m_vPianoRes.glowSlicesReady)
+		return (float)m_vPianoRes.glowSliceExtent;
+	if (blur.type == VirtualPianoData::eBlurType::Kawase)
+	{
+		// A tap reaches offset / 2 texels of the level it writes on the way down, and
+		// offset texels of the level above on the way up, both 2^(i+1) pixels apart.
+		// Offsets shrink with the scene scale while its texels grow, so the reach holds
+		float sceneScale = getSceneScale();
+		float reach = 0.0f;
+		int32_t levels = std::min<int32_t>(blur.passes, (int32_t)m_kawaseMips.size());
+		for (int32_t i = 0; i < levels; i++)
+			reach += (blur.startRadius + (i * blur.increment)) * sceneScale * (float)(2 << i);
+		return (reach + 2.0f) * blur.resolutionDivider / sceneScale;
+	}
+	return blur.getEffectiveSigma() * 3.0f;
+}
+
+void VirtualPiano::__set_bloom_scissor(const sf::FloatRect& scissor)
+{
+	// Clears follow the scissor, so the scissor grown by the reach is cleared first.
+	// Blur taps right outside the scissor then read empty texels rather than what an
+	// earlier, larger region left behind
+	sf::Vector2f viewSize = m_glowView.getSize();
+	float reach = __get_bloom_reach();
+	sf::Vector2f margin { reach / std::max(viewSize.x, 1.0f), reach / std::max(viewSize.y, 1.0f) };
+	float left = std::max(scissor.position.x - margin.x, 0.0f);
+	float top = std::max(scissor.position.y - margin.y, 0.0f);
+	float right = std::min(scissor.position.x + scissor.size.x + margin.x, 1.0f);
+	float bottom = std::min(scissor.position.y + scissor.size.y + margin.y, 1.0f);
+	sf::FloatRect cleared({ left, top }, { right - left, bottom - top });
+	auto l_apply = [&scissor, &cleared](sf::RenderTexture& buffer, sf::View view) {
+		view.setScissor(cleared);
+		buffer.setView(view);
+		buffer.clear(sf::Color::Transparent);
+		view.setScissor(scissor);
+		buffer.setView(view);
+	};
+	l_apply(*m_glowBuffer, m_glowView);
+	l_apply(*m_blurBuff1, m_blurBuff1->getDefaultView());
+	l_apply(*m_blurBuff2, m_blurBuff2->getDefaultView());
+	l_apply(*m_hollowBuff, m_glowView);
+	for (auto* mip : m_kawaseMips)
+		l_apply(*mip, mip->getDefaultView());
+}
+
+void VirtualPiano::__apply_pending_resize(void)
+{
+	if (!m_targetResizePending) return;
+	m_targetResizePending = false;
+	auto& pool = m_vPianoRes.renderTargets;
+	float sceneScale = getSceneScale();
+	sf::Vector2u sceneSize = { (uint32_t)(m_pendingTargetSize.x * sceneScale), (uint32_t)(m_pendingTargetSize.y * sceneScale) };
+	if (m_sceneScaleLevel > 0)
+		pool.reacquire(m_sceneTarget, sceneSize, true);
+	else
+		pool.release(m_sceneTarget);
+	sf::Vector2u size = { sceneSize.x / m_vPianoData.blur.resolutionDivider, sceneSize.y / m_vPianoData.blur.resolutionDivider };
+	// Both blurs rely on bilinear filtering between texel pairs, the glow buffer
+	// included since the first blur pass samples it directly
+	pool.reacquire(m_blurBuff1, size, true);
+	pool.reacquire(m_blurBuff2, size, true);
+	pool.reacquire(m_glowBuffer, size, true);
+	pool.reacquire(m_hollowBuff, size, true);
+	__rebuild_kawase_mips(size);
+	m_glowBuffer->setView(m_glowView);
+	m_hollowBuff->setView(m_glowView);
+	invalidateIdleFrame();
+	m_bloomHistoryValid = false;
+
+	auto& stats = pool.getStats();
+	OX_DEBUG("Render targets: %d/%d in use, %.1f/%.1f MB, %d allocations, %d reuses.",
+				stats.targetsInUse, stats.targetCount,
+				stats.bytesInUse / (1024.0 * 1024.0), stats.bytesAllocated / (1024.0 * 1024.0),
+				(int32_t)stats.allocations, (int32_t)stats.reuses);
+}
+
+void VirtualPiano::__update_dynamic_resolution(double frameTime_ms)
+{
+	// Idle frames wait for events and exports run offline, neither says anything
+	// about how long a frame takes
+	if (!m_dynamicResolution || isIdle() || m_videoRenderer.isRenderingToFile() || frameTime_ms <= 0.0)
+	{
+		m_avgFrameTime_ms = 0.0;
+		m_framesSinceScaleChange = 0;
+		return;
+	}
+	if (m_avgFrameTime_ms == 0.0)
+		m_avgFrameTime_ms = frameTime_ms;
+	else
+		m_avgFrameTime_ms += (frameTime_ms - m_avgFrameTime_ms) * 0.1;
+	if (++m_framesSinceScaleChange < ScaleSettleFrames) return;
+
+	double sinceChange_s = (Common::getCurrentTIme_ns() - m_lastScaleChange_ns) * 1e-9;
+	if (m_avgFrameTime_ms > m_frameBudget_ms && m_sceneScaleLevel + 1 < (int32_t)SceneScaleLevels.size())
+	{
+		if (m_lastScaleChangeWasUp && sinceChange_s < m_scaleUpDelay_s)
+			m_scaleUpDelay_s = std::min(m_scaleUpDelay_s * 2.0, MaxScaleUpDelay_s);
+		m_lastScaleChangeWasUp = false;
+		__set_scene_scale_level(m_sceneScaleLevel + 1);
+	}
+	else if (m_sceneScaleLevel > 0 && m_avgFrameTime_ms < m_frameBudget_ms * 0.95 && sinceChange_s >= m_scaleUpDelay_s)
+	{
+		m_lastScaleChangeWasUp = true;
+		__set_scene_scale_level(m_sceneScaleLevel - 1);
+	}
+	else if (m_lastScaleChangeWasUp && sinceChange_s >= m_scaleUpDelay_s)
+		m_scaleUpDelay_s = MinScaleUpDelay_s;
+}
+
+void VirtualPiano::__update_particle_governor(double frameTime_ms)
+{
+	// Exports are offline and always get the full particle count
+	double particleTime_ms = m_particleTime_ms;
+	m_particleTime_ms = 0.0;
+	if (!m_particleGovernor || m_videoRenderer.isRenderingToFile())
+	{
+		__set_particle_budget(1.0f);
+		m_avgParticleFrameTime_ms = 0.0;
+		m_avgParticleTime_ms = 0.0;
+		return;
+	}
+	// Idle gaps are not frame times, the averages start over from the next active frame
+	if (isIdle() || frameTime_ms <= 0.0)
+	{
+		m_avgParticleFrameTime_ms = 0.0;
+		m_avgParticleTime_ms = 0.0;
+		return;
+	}
+	if (m_avgParticleFrameTime_ms == 0.0)
+	{
+		m_avgParticleFrameTime_ms = frameTime_ms;
+		m_avgParticleTime_ms = particleTime_ms;
+	}
+	else
+	{
+		m_avgParticleFrameTime_ms += (frameTime_ms - m_avgParticleFrameTime_ms) * 0.1;
+		m_avgParticleTime_ms += (particleTime_ms - m_avgParticleTime_ms) * 0.1;
+	}
+
+	// Over budget as a whole, or the simulation alone takes more than its share. Particles
+	// are cut first and quickly, and come back slowly, before the resolution has to drop
+	double pressure = std::max(m_avgParticleFrameTime_ms / m_frameBudget_ms, m_avgParticleTime_ms / (m_frameBudget_ms * ParticleTimeShare));
+	float budget = m_particleBudget;
+	if (pressure > 1.0)
+		budget *= ParticleBudgetDecay;
+	else if (pressure < 0.85)
+		budget += ParticleBudgetRecovery;
+	__set_particle_budget(std::clamp(budget, MinParticleBudget, 1.0f));
+}
+
+void VirtualPiano::__set_particle_budget(float budget)
+{
+	// Applied every frame, emitters are recreated whenever the style is reloaded
+	m_particleBudget = budget;
+	for (auto& pk : m_vKeyboard.m_pianoKeys)
+	{
+		if (budget >= 1.0f)
+			pk.particles.setLiveParticleLimit(UINT32_MAX);
+		else
+			pk.particles.setLiveParticleLimit((uint32_t)std::ceil((float)pk.particles.getMaxParticleCount() * budget));
+	}
+}
+
+uint16_t VirtualPiano::__get_particle_emit_count(void)
+{
+	if (m_partPerFrame == 0 || m_particleBudget >= 1.0f) return m_partPerFrame;
+	return (uint16_t)std::max(1.0f, std::round((float)m_partPerFrame * m_particleBudget));
+}
+
+void VirtualPiano::__set_scene_scale_level(int32_t level)
+{
+	m_sceneScaleLevel = level;
+	m_framesSinceScaleChange = 0;
+	m_avgFrameTime_ms = 0.0;
+	m_lastScaleChange_ns = Common::getCurrentTIme_ns();
+	m_targetResizePending = true;
+	__apply_pending_resize();
+	m_vPianoRes.buildGaussianKernel(m_vPianoData, getSceneScale());
+	OX_DEBUG("Scene resolution: %d%%.", (int32_t)std::round(getSceneScale() * 100.0f));
+}
+
+void VirtualPiano::__render_scaled_frame(void)
+{
+	// Same coordinates as the window, fewer pixels behind them
+	sf::Vector2f viewSize { (float)m_pendingTargetSize.x, (float)m_pendingTargetSize.y };
+	m_sceneTarget->setView(sf::View(sf::FloatRect({ 0.0f, 0.0f }, viewSize)));
+	renderFrame(*m_sceneTarget);
+	m_sceneTarget->display();
+
+	Renderer::setRenderTarget(nullptr);
+	Renderer::useTexture(nullptr);
+	Renderer::useShader(nullptr);
+	sf::Vector2u sceneSize = m_sceneTarget->getSize();
+	Renderer::drawTexture(m_sceneTarget->getTexture(), { 0.0f, 0.0f }, { viewSize.x / sceneSize.x, viewSize.y / sceneSize.y });  // Upscale
+}
+
+bool VirtualPiano::__can_reuse_bloom(void)
+{
+	// Only while every glow source scrolls down at pps(): during playback, with either
+	// the note mesh or a falling time that matches the distance to the keyboard. The
+	// glow slices already draw the bloom in one pass, refreshing bands would cost more
+	auto& vpd = m_vPianoData;
+	if (!vpd.blur.temporalReuse || !m_playing || isLiveInputActive() || m_videoRenderer.isRenderingToFile())
+		return false;
+	if (vpd.blur.useGlowSlices && m_vPianoRes.glowSlicesReady)
+		return false;
+	return m_vKeyboard.__use_note_mesh() || std::abs(vpd.vpy() - vpd.fallingTime_s * vpd.pps()) < 0.5;
+}
+
+sf::IntRect VirtualPiano::__get_bloom_rect(const sf::FloatRect& glowBounds, const sf::Vector2f& scale, float lag)
+{
+	// Texels of a bloom buffer drawn with the glow view moved up by lag that cover glowBounds
+	sf::Vector2i size { (int32_t)m_glowBuffer->getSize().x, (int32_t)m_glowBuffer->getSize().y };
+	sf::Vector2i bloomPos { (int32_t)std::floor(glowBounds.position.x / scale.x), (int32_t)std::floor((glowBounds.position.y - lag) / scale.y) };
+	sf::Vector2i bloomEnd { (int32_t)std::ceil((glowBounds.position.x + glowBounds.size.x) / scale.x), (int32_t)std::ceil((glowBounds.position.y + glowBounds.size.y - lag) / scale.y) };
+	bloomPos = { std::clamp(bloomPos.x, 0, size.x), std::clamp(bloomPos.y, 0, size.y) };
+	bloomEnd = { std::clamp(bloomEnd.x, 0, size.x), std::clamp(bloomEnd.y, 0, size.y) };
+	return sf::IntRect(bloomPos, bloomEnd - bloomPos);
+}
+
+bool VirtualPiano::__reuse_bloom(const sf::FloatRect& glowBounds, sf::IntRect& outRect, sf::Vector2f& outScale, float& outLag)
+{
+	if (!m_bloomHistoryValid || !__can_reuse_bloom()) return false;
+	auto& vpd = m_vPianoData;
+	sf::Vector2u size = m_glowBuffer->getSize();
+	sf::Vector2f viewSize = m_glowView.getSize();
+	double dt = m_vKeyboard.m_visualTime - m_bloomHistoryTime;
+	if (m_bloomHistory[m_bloomHistoryIndex]->getSize() != size || vpd.pps() != m_bloomHistoryPps || dt < 0.0)
+		return false;
+
+	// Scroll by whole texels so the history is copied, not resampled, and carry the rest
+	sf::Vector2f scale = { viewSize.x / size.x, viewSize.y / size.y };
+	float lag = m_bloomLag_px + (float)(dt * vpd.pps());
+	int32_t shift = (int32_t)std::floor(lag / scale.y);
+	lag -= shift * scale.y;
+
+	// Everything outside the glow bounds is empty, only their texels are carried over,
+	// refreshed and composited
+	sf::IntRect bloomRect = __get_bloom_rect(glowBounds, scale, lag);
+	if (bloomRect.size.x <= 0 || bloomRect.size.y <= 0)
+		return false;
+	int32_t rectTop = bloomRect.position.y;
+	int32_t rectBottom = bloomRect.position.y + bloomRect.size.y;
+
+	// Fresh bands: the top, where scrolled-in texels and the old clamped edge affect the
+	// result, and from the keyboard down, where notes are cut off and removed
+	float reach = __get_bloom_reach();
+	int32_t topRows = std::min<int32_t>(shift + 1 + (int32_t)std::ceil(reach / scale.y), (int32_t)size.y);
+	int32_t bottomFirst = std::clamp<int32_t>((int32_t)std::floor((vpd.vpy() - reach - lag) / scale.y), 0, (int32_t)size.y);
+	int32_t topBand = std::max(std::min(topRows, rectBottom) - rectTop, 0);
+	int32_t bottomBand = std::max(rectBottom - std::max(bottomFirst, rectTop), 0);
+	if (topBand + bottomBand > bloomRect.size.y * 3 / 4)
+		return false;
+
+	auto* previous = m_bloomHistory[m_bloomHistoryIndex];
+	auto* next = m_bloomHistory[1 - m_bloomHistoryIndex];
+	next->setView(next->getDefaultView());
+	next->clear(sf::Color::Transparent);
+	int32_t copyFirst = std::max(rectTop - shift, 0);
+	int32_t copyEnd = std::min(rectBottom - shift, (int32_t)size.y - shift);
+	__copy_bloom_rows(*previous, *next, copyFirst, copyEnd - copyFirst, shift, bloomRect.position.x, bloomRect.size.x);
+
+	// Bands are blurred with the glow view moved up by the lag, like the history
+	sf::View currentView = m_glowView;
+	m_glowView.move({ 0.0f, lag });
+	float scissorLeft = glowBounds.position.x / viewSize.x;
+	float scissorWidth = glowBounds.size.x / viewSize.x;
+	auto l_refresh = [&](int32_t firstRow, int32_t rowCount) {
+		if (rowCount <= 0) return;
+		// The scissor grows by the reach, so the band itself sees every tap it needs
+		int32_t reachRows = (int32_t)std::ceil(reach / scale.y) + 1;
+		int32_t top = std::max(firstRow - reachRows, 0);
+		int32_t bottom = std::min(firstRow + rowCount + reachRows, (int32_t)size.y);
+		__set_bloom_scissor(sf::FloatRect({ scissorLeft, (float)top / size.y }, { scissorWidth, (float)(bottom - top) / size.y }));
+		auto& blurred = __apply_blur(vpd.blur.passes, vpd.blur.bloomIntensity, vpd.blur.startRadius, vpd.blur.increment, vpd.blur.threshold);
+		__copy_bloom_rows(blurred, *next, firstRow, rowCount, 0, bloomRect.position.x, bloomRect.size.x);
+	};
+	l_refresh(rectTop, topBand);
+	l_refresh(rectBottom - bottomBand, bottomBand);
+	next->display();
+
+	// The mask only matters under the composited rectangle, at the same lag as the bloom
+	sf::View hollowView = m_glowView;
+	hollowView.setScissor(sf::FloatRect({ (float)bloomRect.position.x / size.x, (float)bloomRect.position.y / size.y },
+										{ (float)bloomRect.size.x / size.x, (float)bloomRect.size.y / size.y }));
+	m_hollowBuff->setView(hollowView);
+	m_hollowBuff->clear(sf::Color::Transparent);
+	m_vKeyboard.renderHollowNoteNegative(*m_hollowBuff);
+	m_hollowBuff->display();
+	m_glowView = currentView;
+	m_glowBuffer->setView(m_glowView);
+
+	m_bloomHistoryIndex = 1 - m_bloomHistoryIndex;
+	m_bloomHistoryTime = m_vKeyboard.m_visualTime;
+	m_bloomLag_px = lag;
+	outRect = bloomRect;
+	outScale = scale;
+	outLag = lag;
+	return true;
+}
+
+void VirtualPiano::__seed_bloom_history(sf::RenderTexture* bloom, const sf::IntRect& bloomRect)
+{
+	m_bloomHistoryValid = false;
+	if (!__can_reuse_bloom()) return;
+	auto& pool = m_vPianoRes.renderTargets;
+	sf::Vector2u size = m_glowBuffer->getSize();
+	for (auto*& history : m_bloomHistory)
+	{
+		if (history == nullptr || history->getSize() != size)
+			pool.reacquire(history, size);
+	}
+	auto* history = m_bloomHistory[m_bloomHistoryIndex];
+	history->setView(history->getDefaultView());
+	history->clear(sf::Color::Transparent);
+	// Only the bloom rectangle was cleared and blurred, the rest of the buffer is stale
+	if (bloom != nullptr)
+		__copy_bloom_rows(*bloom, *history, bloomRect.position.y, bloomRect.size.y, 0, bloomRect.position.x, bloomRect.size.x);
+	history->display();
+	m_bloomHistoryValid = true;
+	m_bloomHistoryTime = m_vKeyboard.m_visualTime;
+	m_bloomHistoryPps = m_vPianoData.pps();
+	m_bloomLag_px = 0.0f;
+}
+
+void VirtualPiano::__copy_bloom_rows(const sf::RenderTexture& src, sf::RenderTexture& dst, int32_t firstRow, int32_t rowCount, int32_t shift, int32_t firstColumn, int32_t columnCount)
+{
+	if (columnCount < 0)
+		columnCount = (int32_t)src.getSize().x - firstColumn;
+	if (rowCount <= 0 || columnCount <= 0) return;
+	sf::Sprite rows(src.getTexture(), sf::IntRect({ firstColumn, firstRow }, { columnCount, rowCount }));
+	rows.setPosition({ (float)firstColumn, (float)(firstRow + shift) });
+	sf::RenderStates copyState;
+	copyState.blendMode = sf::BlendNone;
+	Renderer::setRenderTarget(&dst);
+	Renderer::useShader(nullptr);
+	Renderer::useTexture(nullptr);
+	Renderer::useRenderStates(&copyState);
+	Renderer::drawSprite(rows);
+	Renderer::useRenderStates(nullptr);
+}
+
+void VirtualPiano::__rebuild_kawase_mips(const sf::Vector2u& baseSize)
+{
+	auto& pool = m_vPianoRes.renderTargets;
+	for (auto*& mip : m_kawaseMips)
+		pool.release(mip);
+	m_kawaseMips.clear();
+	sf::Vector2u size = baseSize;
+	for (int32_t i = 0; i < MaxKawaseLevels; i++)
+	{
+		size = { size.x / 2, size.y / 2 };
+		if (size.x < 2 || size.y < 2) break;
+		m_kawaseMips.push_back(pool.acquire(size, true));
+	}
+}
+
 sf::RenderTexture& VirtualPiano::__apply_gaussian_blur(uint8_t passes, float intensity, float start_radius, float increment, float threshold)
 {
-	m_glowBuffer.clear(sf::Color::Transparent);
-    m_vKeyboard.renderFallingNotesGlow(m_glowBuffer);
-    m_glowBuffer.display();
-
-	m_blurBuff1.clear(sf::Color::Transparent);
-	Renderer::setRenderTarget(&m_blurBuff1);
-	Renderer::useShader(&m_vPianoRes.thresholdShader);
-	m_vPianoRes.thresholdShader.setUniform("texture", m_glowBuffer.getTexture());
-	m_vPianoRes.thresholdShader.setUniform("threshold", threshold);
-	Renderer::drawTexture(m_glowBuffer.getTexture());
-	m_blurBuff1.display();
-
-	auto blurPass = [&](sf::RenderTexture& src, sf::RenderTexture& dst, bool horizontal, float radius, float intensity) {
-        m_vPianoRes.gaussianBlurShader.setUniform("texture", src.getTexture());
-        m_vPianoRes.gaussianBlurShader.setUniform("direction", horizontal ? sf::Glsl::Vec2(1.0f, 0.0f) : sf::Glsl::Vec2(0.0f, 1.0f));
-        m_vPianoRes.gaussianBlurShader.setUniform("resolution", (horizontal ? (float)dst.getSize().x : (float)dst.getSize().y));
-        m_vPianoRes.gaussianBlurShader.setUniform("radius", radius);
-        m_vPianoRes.gaussianBlurShader.setUniform("bloomIntensity", intensity);
+	m_glowBuffer->clear(sf::Color::Transparent);
+    m_vKeyboard.renderFallingNotesGlow(*m_glowBuffer);
+    m_glowBuffer->display();
+
+	// passes, start_radius, increment and intensity are already folded into the kernel,
+	// see VPianoResources::buildGaussianKernel
+	auto& kernel = m_vPianoRes.gaussianKernel;
+	auto& shader = m_vPianoRes.gaussianBlurShader;
+	shader.setUniformArray("offsets", kernel.offsets.data(), kernel.offsets.size());
+	shader.setUniformArray("weights", kernel.weights.data(), kernel.weights.size());
+	shader.setUniform("tapCount", kernel.tapCount);
+	shader.setUniform("bloomIntensity", kernel.passIntensity);
+	shader.setUniform("threshold", threshold);
+	auto blurPass = [&](sf::RenderTexture& src, sf::RenderTexture& dst, bool horizontal) {
+        shader.setUniform("texture", src.getTexture());
+        shader.setUniform("applyThreshold", &src == m_glowBuffer);
+        shader.setUniform("direction", horizontal ? sf::Glsl::Vec2(1.0f, 0.0f) : sf::Glsl::Vec2(0.0f, 1.0f));
+        shader.setUniform("resolution", (horizontal ? (float)dst.getSize().x : (float)dst.getSize().y));
 
         dst.clear(sf::Color::Transparent);
         Renderer::setRenderTarget(&dst);
-        Renderer::useShader(&m_vPianoRes.gaussianBlurShader);
+        Renderer::useShader(&shader);
         Renderer::drawTexture(src.getTexture());
         dst.display();
     };
-    auto applyBlur = [&](sf::RenderTexture& buff1, sf::RenderTexture& buff2, uint8_t passes, float radius, float intensity, float increment) -> sf::RenderTexture& {
-		float offset = radius;
-		for (int32_t i = 0; i < passes; i++)
-		{
-			blurPass(buff1, buff2, true, offset, intensity);
-			blurPass(buff2, buff1, false, offset, intensity);
-			offset += increment;
-		}
-		return buff1;
-    };
-    auto& finalBlurBuff = applyBlur(m_blurBuff1, m_blurBuff2, passes, start_radius, intensity, increment);
+	// The first horizontal pass reads the glow buffer and thresholds its taps
+	for (int32_t i = 0; i < kernel.passes; i++)
+	{
+		blurPass((i == 0 ? *m_glowBuffer : *m_blurBuff1), *m_blurBuff2, true);
+		blurPass(*m_blurBuff2, *m_blurBuff1, false);
+	}
+    auto& finalBlurBuff = *m_blurBuff1;
     Renderer::setRenderTarget(nullptr);
     Renderer::useShader(nullptr);
     Renderer::useTexture(nullptr);
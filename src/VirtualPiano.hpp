@@ -25,6 +25,7 @@
 #include <ostd/Json.hpp>
 #include "VPianoResources.hpp"
 #include "VirtualKeyboard.hpp"
+#include "LiveMidiInput.hpp"
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderTexture.hpp>
 
@@ -38,14 +39,22 @@ class VirtualPiano
 		inline VirtualPiano(Window& parentWindow) : m_vPianoRes(*this), m_sigListener(*this), m_parentWindow(parentWindow), m_videoRenderer(*this), m_vKeyboard(*this) {  }
 		void init(void);
 		void loadProjectFile(const ostd::String& filePath);
-		void onWindowResized(uint32_t width, uint32_t height);
+		void onWindowResized(uint32_t width, uint32_t height, bool deferred = false);
 
 		// Playback functionality
 		void play(void);
 		void pause(void);
 		void stop(void);
+		// Jumps to time_s. Stopped playback becomes paused at the new time
+		void seek(double time_s);
 		double getPlayTime_s(void);
 
+		// Live input
+		bool startLiveInput(const ostd::String& source);
+		void stopLiveInput(void);
+		void onFrameDisplayed(void);
+		inline bool isLiveInputActive(void) const { return m_liveInput.isOpen(); }
+
 		// Update and Render
 		void update(void);
 		void render(std::optional<std::reference_wrapper<sf::RenderTarget>> target = std::nullopt);
@@ -57,9 +66,33 @@ class VirtualPiano
 		inline VirtualKeyboard& vKeyboard(void) { return m_vKeyboard; }
 		inline VideoRenderer& getVideoRenderer(void) { return m_videoRenderer; }
 		inline bool isPlaying(void) { return m_playing; }
+		inline bool isPaused(void) { return m_paused; }
+		// Nothing moves while stopped or paused: particles only advance during playback,
+		// live input or export
+		inline bool isIdle(void) { return !m_playing && !isLiveInputActive() && !m_videoRenderer.isRenderingToFile(); }
+		inline void invalidateIdleFrame(void) { m_idleFrameValid = false; }
 		inline Window& getParentWindow(void) { return m_parentWindow; }
+		inline float getSceneScale(void) const { return SceneScaleLevels[m_sceneScaleLevel]; }
 
 	private:
+		void __process_live_input(void);
+		void __render_idle_frame(void);
+		void __apply_pending_resize(void);
+		void __update_dynamic_resolution(double frameTime_ms);
+		void __update_particle_governor(double frameTime_ms);
+		void __set_particle_budget(float budget);
+		uint16_t __get_particle_emit_count(void);
+		void __warm_up_particles(double time_s);
+		void __set_scene_scale_level(int32_t level);
+		void __render_scaled_frame(void);
+		void __rebuild_kawase_mips(const sf::Vector2u& baseSize);
+		float __get_bloom_reach(void);
+		void __set_bloom_scissor(const sf::FloatRect& scissor);
+		bool __can_reuse_bloom(void);
+		sf::IntRect __get_bloom_rect(const sf::FloatRect& glowBounds, const sf::Vector2f& scale, float lag);
+		bool __reuse_bloom(const sf::FloatRect& glowBounds, sf::IntRect& outRect, sf::Vector2f& outScale, float& outLag);
+		void __seed_bloom_history(sf::RenderTexture* bloom, const sf::IntRect& bloomRect);
+		void __copy_bloom_rows(const sf::RenderTexture& src, sf::RenderTexture& dst, int32_t firstRow, int32_t rowCount, int32_t shift, int32_t firstColumn = 0, int32_t columnCount = -1);
 		inline sf::RenderTexture& __apply_blur(uint8_t passes = 6, float intensity = 1.0f, float start_offset = 1.0f, float increment = 1.0f, float threshold = 0.1f);
 		inline sf::RenderTexture& __apply_kawase_blur(uint8_t passes = 6, float intensity = 1.0f, float start_offset = 1.0f, float increment = 1.0f, float threshold = 0.1f);
 		inline sf::RenderTexture& __apply_gaussian_blur(uint8_t passes = 6, float intensity = 1.0, float start_radius = 1.0f, float increment = 1.0f, float threshold = 0.1f);
@@ -84,14 +117,75 @@ class VirtualPiano
 		double m_pausedTime_ns { 0.0 };
 		uint16_t m_partPerFrame { 10 }
 ;
-		sf::RenderTexture m_glowBuffer;
-		sf::RenderTexture m_blurBuff1;
-		sf::RenderTexture m_blurBuff2;
-		sf::RenderTexture m_hollowBuff;
+		// Offscreen targets are owned by m_vPianoRes.renderTargets
+		sf::RenderTexture* m_glowBuffer { nullptr };
+		sf::RenderTexture* m_blurBuff1 { nullptr };
+		sf::RenderTexture* m_blurBuff2 { nullptr };
+		sf::RenderTexture* m_hollowBuff { nullptr };
+		// Dual Kawase pyramid at 1/2, 1/4, ... of the blur buffer size
+		std::vector<sf::RenderTexture*> m_kawaseMips;
+		// Temporal bloom: the blurred glow of the previous frame, scrolled along with the
+		// notes. m_bloomLag_px is how far (in window pixels) its content sits above the
+		// notes, always less than one buffer texel
+		std::array<sf::RenderTexture*, 2> m_bloomHistory { nullptr, nullptr };
+		int32_t m_bloomHistoryIndex { 0 };
+		bool m_bloomHistoryValid { false };
+		double m_bloomHistoryTime { 0.0 };
+		float m_bloomHistoryPps { 0.0f };
+		float m_bloomLag_px { 0.0f };
+		sf::Vector2u m_pendingTargetSize { 0, 0 };
+		bool m_targetResizePending { false };
+		sf::Clock m_targetResizeClock;
 		sf::View m_glowView;
 		bool m_showBackground { true };
+		// Last composed frame, shown again as long as the scene is idle
+		sf::RenderTexture* m_idleFrame { nullptr };
+		bool m_idleFrameValid { false };
+		// Dynamic resolution: the scene and bloom render at SceneScaleLevels[m_sceneScaleLevel]
+		// of the window size while the rolling frame time is over budget
+		sf::RenderTexture* m_sceneTarget { nullptr };
+		int32_t m_sceneScaleLevel { 0 };
+		bool m_dynamicResolution { true };
+		double m_frameBudget_ms { 18.0 };
+		double m_avgFrameTime_ms { 0.0 };
+		int32_t m_framesSinceScaleChange { 0 };
+		double m_lastScaleChange_ns { 0.0 };
+		double m_scaleUpDelay_s { MinScaleUpDelay_s };
+		bool m_lastScaleChangeWasUp { false };
+		// Particle governor: emission and the live cap of every emitter are scaled by
+		// m_particleBudget while frames or the particle simulation run over budget
+		bool m_particleGovernor { true };
+		float m_particleBudget { 1.0f };
+		double m_particleTime_ms { 0.0 };
+		double m_avgParticleTime_ms { 0.0 };
+		double m_avgParticleFrameTime_ms { 0.0 };
+
+		LiveMidiInput m_liveInput;
+		LiveMidiInput::tLatencyStats m_liveLatency;
+		std::vector<double> m_pendingLatencySamples_ns;
+		double m_lastFrameDisplayed_ns { 0.0 };
+		double m_liveStatsStart_ns { 0.0 };
 
 		friend class SignalListener;
 		friend class VPianoResources;
 		friend class VirtualKeyboard;
+
+	public:
+		inline static constexpr int32_t MaxKawaseLevels { VirtualPianoData::BlurData::MaxKawaseLevels };
+		// Quiet time after the last resize event before offscreen targets follow
+		inline static constexpr int32_t ResizeSettleTime_ms { 150 };
+		inline static constexpr std::array<float, 3> SceneScaleLevels { 1.0f, 0.67f, 0.5f };
+		inline static constexpr int32_t ScaleSettleFrames { 30 };
+		// Time under budget before trying the next higher resolution. Doubled whenever
+		// that attempt has to be undone, so a scene right at the limit does not flicker
+		inline static constexpr double MinScaleUpDelay_s { 2.0 };
+		inline static constexpr double MaxScaleUpDelay_s { 30.0 };
+		inline static constexpr float MinParticleBudget { 0.2f };
+		inline static constexpr float ParticleBudgetDecay { 0.97f };
+		inline static constexpr float ParticleBudgetRecovery { 0.005f };
+		// Share of the frame budget the particle simulation may use
+		inline static constexpr double ParticleTimeShare { 0.25 };
+		inline static constexpr double SeekStep_s { 5.0 };
+		// Fixed update rate the particles are warmed up at after a seek
+		inline static constexpr double ParticleUpdateRate { 60.0 };
 };
@@ -80,7 +80,21 @@ void Window::handleSignal(ostd::tSignal& signal)
 		{
 			if (!m_vpiano.getVideoRenderer().isRenderingToFile())
 			{
-				m_vpiano.stop();
+				// Ends live input first, the next Enter stops playback as usual
+				if (m_vpiano.isLiveInputActive())
+					m_vpiano.stopLiveInput();
+				else
+					m_vpiano.stop();
+			}
+		}
+		else if (evtData.keyCode == (int32_t)sf::Keyboard::Key::Left || evtData.keyCode == (int32_t)sf::Keyboard::Key::Right)
+		{
+			if (!m_vpiano.getVideoRenderer().isRenderingToFile())
+			{
+				// The play clock keeps running while stopped, a stopped song is at its start
+				double step = (evtData.keyCode == (int32_t)sf::Keyboard::Key::Left ? -VirtualPiano::SeekStep_s : VirtualPiano::SeekStep_s);
+				double current = (m_vpiano.isPlaying() || m_vpiano.isPaused() ? m_vpiano.getPlayTime_s() : 0.0);
+				m_vpiano.seek(current + step);
 			}
 		}
 		else if (evtData.keyCode == (int32_t)sf::Keyboard::Key::F9)
@@ -134,7 +148,7 @@ void Window::handleSignal(ostd::tSignal& signal)
 			view.setCenter({ evtData.new_width / 2.f, evtData.new_height / 2.f });
 			m_window.setView(view);
 			m_vpiano.vPianoData().updateScale(evtData.new_width, evtData.new_height);
-			m_vpiano.onWindowResized((uint32_t)evtData.new_width, (uint32_t)evtData.new_height);
+			m_vpiano.onWindowResized((uint32_t)evtData.new_width, (uint32_t)evtData.new_height, true);
 			__update_local_window_size((uint32_t)evtData.new_width, (uint32_t)evtData.new_height);
 		}
 	}
@@ -165,6 +179,11 @@ void Window::onFixedUpdate(double frameTime_s)
 	m_vpiano.update();
 }
 
+void Window::onFrameDisplayed(void)
+{
+	m_vpiano.onFrameDisplayed();
+}
+
 void Window::onUpdate(void)
 {
 }
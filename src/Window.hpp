@@ -40,6 +40,8 @@ class Window : public WindowBase
 		void onRender(void) override;
 		void onUpdate(void) override;
 		void onFixedUpdate(double frameTime_s) override;
+		void onFrameDisplayed(void) override;
+		inline bool canIdle(void) override { return m_vpiano.isIdle(); }
 		void enableFullscreen(bool enable = true);
 		void enableResizeable(bool enable = true);
 
@@ -47,6 +49,7 @@ class Window : public WindowBase
 		inline void lockFullscreenStatus(bool lock = true) { m_lockFullscreenStatus = lock; }
 		inline bool isFullscreenStatusLocked(void) const { return m_lockFullscreenStatus; }
 		inline const VirtualPiano& getVirtualPiano(void) const { return m_vpiano; }
+		inline bool startLiveInput(const ostd::String& source) { return m_vpiano.startLiveInput(source); }
 
 	private:
 		ostd::Vec2 m_windowSizeBeforeFullscreen { 0.0f, 0.0f };
@@ -24,6 +24,8 @@
 #include "Common.hpp"
 #include "Window.hpp"
 #include "ffmpeg_helper.hpp"
+#include "MidiLoader.hpp"
+#include "Particles.hpp"
 
 #include <libintl.h>
 #include <locale.h>
@@ -47,9 +49,35 @@ int main(int argc, char** argv)
 
 	std::signal(SIGINT, handleSigint);
 
+	// --bench-load [directory] [iterations]: time MIDI loading and exit without opening a window
+	if (argc > 1 && ostd::String(argv[1]) == "--bench-load")
+	{
+		ostd::String directory = (argc > 2 ? argv[2] : "extra/music");
+		int32_t iterations = (argc > 3 ? std::max(std::atoi(argv[3]), 1) : 10);
+		MidiLoader::runLoadBenchmark(directory, iterations);
+		return 0;
+	}
+
+	// --bench-particles [emitters] [particles] [frames]: time the particle update kernels and exit
+	if (argc > 1 && ostd::String(argv[1]) == "--bench-particles")
+	{
+		int32_t emitters = (argc > 2 ? std::max(std::atoi(argv[2]), 1) : 88);
+		int32_t particles = (argc > 3 ? std::max(std::atoi(argv[3]), 1) : 2500);
+		int32_t frames = (argc > 4 ? std::max(std::atoi(argv[4]), 1) : 100);
+		ParticleEmitter::runUpdateBenchmark(emitters, particles, frames);
+		return 0;
+	}
+
 	Window window;
 	window.initialize(VirtualPianoData::base_width, VirtualPianoData::base_height, "KeyLight");
 
+	// --live <source>: raw MIDI device, named pipe, or a .mid file replayed as if played live
+	for (int32_t i = 1; i + 1 < argc; i++)
+	{
+		if (ostd::String(argv[i]) == "--live" && !window.startLiveInput(argv[i + 1]))
+			OX_ERROR("Unable to start live MIDI input.");
+	}
+
 	auto ffmpegPath = FFMPEG::getExecutablePath().trim();
 	if (ffmpegPath != "")
 		OX_DEBUG("FFMPEG found: %s", ffmpegPath.c_str());